@@ -0,0 +1,239 @@
+/*
+  FPM383F Access Journal Example
+
+  This example runs a door controller that records every match, rejected
+  finger, enrollment and sensor error in an append-only journal on an SD
+  card, and uploads the journal in batches.
+
+  The unlock path never waits for storage: journal.log() only copies the
+  event into RAM, and journal.update() writes whole pages to the card
+  between scans. The journal file is used as a ring, so the oldest events
+  are overwritten once it is full.
+
+  Every UPLOAD_INTERVAL (or when 'u' is sent) events are printed as CSV
+  lines on Serial, standing in for a network upload, one batch per loop()
+  pass so scanning continues. The upload cursor only advances past events
+  that were sent; keep it in EEPROM or on the server to resume after a
+  reboot.
+
+  Serial commands:
+  - u: upload now
+  - e: enroll a fingerprint into the next free ID
+
+  Hardware Connections:
+  - V_TOUCH: 3.3V
+  - TOUCHOUT: Digital Pin 3 (optional)
+  - VCC: 3.3V
+  - TX: Digital Pin 2
+  - RX: Digital Pin 4 (with 10kΩ pull-up)
+  - GND: GND
+  - SD card module: SPI, CS on Digital Pin 10
+  - Door strike relay: Digital Pin 7
+*/
+
+#include <SD.h>
+#include <FPM383F.h>
+#include <FPM383FScanner.h>
+#include <FPM383FJournal.h>
+
+#define SD_CS_PIN 10
+#define LOCK_PIN 7
+#define UNLOCK_TIME 3000
+#define JOURNAL_FILE "/access.log"
+#define JOURNAL_SIZE 16384UL
+#define JOURNAL_BLOCK_SIZE 512
+#define UPLOAD_INTERVAL 60000
+#define UPLOAD_BATCH 8
+#define MAX_FINGERPRINT_ID 59
+
+// Journal storage in a fixed-size file. SD cards have no erase, so erase()
+// fills the block with 0xFF.
+class SdJournalStorage : public FPM383FJournalStorage {
+public:
+  bool begin() {
+    file = SD.open(JOURNAL_FILE, O_READ | O_WRITE | O_CREAT);
+    if (!file) return false;
+
+    // Extend a new or short file with blank blocks
+    uint32_t size = file.size();
+    for (uint32_t address = size - size % JOURNAL_BLOCK_SIZE; address < JOURNAL_SIZE;
+         address += JOURNAL_BLOCK_SIZE) {
+      if (!erase(address)) return false;
+    }
+    return true;
+  }
+
+  uint32_t getSize() { return JOURNAL_SIZE; }
+  uint32_t getEraseSize() { return JOURNAL_BLOCK_SIZE; }
+
+  bool read(uint32_t address, uint8_t* data, uint16_t length) {
+    return file.seek(address) && file.read(data, length) == length;
+  }
+
+  bool write(uint32_t address, const uint8_t* data, uint16_t length) {
+    if (!file.seek(address) || file.write(data, length) != length) return false;
+    file.flush();
+    return true;
+  }
+
+  bool erase(uint32_t address) {
+    uint8_t blank[32];
+    memset(blank, 0xFF, sizeof(blank));
+    if (!file.seek(address)) return false;
+    for (uint16_t i = 0; i < JOURNAL_BLOCK_SIZE; i += sizeof(blank)) {
+      if (file.write(blank, sizeof(blank)) != sizeof(blank)) return false;
+    }
+    file.flush();
+    return true;
+  }
+
+private:
+  File file;
+};
+
+// Initialize sensor (RX pin 2, TX pin 4, Touch interrupt pin 3)
+FPM383F fingerprint(2, 4, 3);
+FPM383FScanner scanner(fingerprint);
+SdJournalStorage journalStorage;
+FPM383FJournal journal(fingerprint, journalStorage);
+
+FPM383FJournalCursor uploadCursor;
+uint32_t lastUpload = 0;
+uint32_t uploadedCount = 0;
+bool uploading = false;
+uint32_t unlockedAt = 0;
+bool unlocked = false;
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("FPM383F Access Journal Example");
+  Serial.println("==============================");
+
+  pinMode(LOCK_PIN, OUTPUT);
+  digitalWrite(LOCK_PIN, LOW);
+
+  if (!SD.begin(SD_CS_PIN) || !journalStorage.begin()) {
+    Serial.println("SD card initialization failed!");
+    while(1);
+  }
+
+  if (!journal.begin()) {
+    Serial.println("Journal unreadable, formatting...");
+    if (!journal.format()) {
+      Serial.println("Journal format failed!");
+      while(1);
+    }
+  }
+  uploadCursor = journal.getOldestCursor();
+  Serial.println("Journal: events " + String(journal.getOldestSequence()) + " to " +
+                 String(journal.getNextSequence()));
+
+  if (fingerprint.begin()) {
+    Serial.println("Sensor initialized successfully!");
+  } else {
+    Serial.println("Failed to initialize sensor!");
+    Serial.println("Error: " + fingerprint.getErrorString(fingerprint.getLastError()));
+    journal.log(FP_JOURNAL_ERROR, 0, 0, fingerprint.getLastError());
+    journal.flush();
+    while(1);
+  }
+
+  scanner.start();
+  Serial.println("Ready. Send 'u' to upload, 'e' to enroll.");
+}
+
+void loop() {
+  uint8_t event = scanner.update();
+
+  if (event == FP_SCAN_MATCH) {
+    // Unlock first; logging is a RAM copy
+    digitalWrite(LOCK_PIN, HIGH);
+    unlocked = true;
+    unlockedAt = millis();
+    journal.logMatch(scanner.getResult());
+    Serial.println("Unlocked for ID " + String(scanner.getResult().fingerprintId));
+  } else if (event == FP_SCAN_NO_MATCH) {
+    journal.logMatch(scanner.getResult());
+    Serial.println("Access denied");
+  } else if (event == FP_SCAN_ERROR) {
+    journal.log(FP_JOURNAL_ERROR, 0, 0, scanner.getLastError());
+  }
+
+  if (unlocked && millis() - unlockedAt >= UNLOCK_TIME) {
+    digitalWrite(LOCK_PIN, LOW);
+    unlocked = false;
+  }
+
+  // Writes a page when one is full, or pending events after a few seconds
+  if (!journal.update()) {
+    Serial.println("Journal write failed");
+  }
+
+  // One batch per pass, so scanning continues during an upload
+  if (uploading || millis() - lastUpload >= UPLOAD_INTERVAL) {
+    uploadBatch();
+  }
+
+  if (Serial.available()) {
+    char command = Serial.read();
+    if (command == 'u') {
+      uploadBatch();
+    } else if (command == 'e') {
+      enrollNextId();
+    }
+  }
+}
+
+void uploadBatch() {
+  FPM383FJournalEvent events[UPLOAD_BATCH];
+
+  if (!uploading) {
+    lastUpload = millis();
+    uploadedCount = 0;
+    if (uploadCursor.sequence < journal.getOldestSequence()) {
+      Serial.println("Lost " + String(journal.getOldestSequence() - uploadCursor.sequence) +
+                     " events (journal wrapped before upload)");
+    }
+  }
+
+  // Read with a copy so the cursor only advances once the batch is sent
+  FPM383FJournalCursor cursor = uploadCursor;
+  uint16_t count = journal.read(cursor, events, UPLOAD_BATCH);
+  for (uint16_t i = 0; i < count; i++) {
+    // sequence,timestamp,type,id,score,error
+    Serial.println("EVENT," + String(events[i].sequence) + "," + String(events[i].timestamp) + "," +
+                   String(events[i].type) + "," + String(events[i].fingerprintId) + "," +
+                   String(events[i].score) + "," + String(events[i].errorCode));
+  }
+  uploadCursor = cursor;
+  uploadedCount += count;
+  uploading = count == UPLOAD_BATCH;
+
+  if (!uploading) {
+    Serial.println("Uploaded " + String(uploadedCount) + " events, " + String(journal.getPageWrites()) +
+                   " page writes, " + String(journal.getErases()) + " erases, " +
+                   String(journal.getDroppedCount()) + " dropped");
+  }
+}
+
+void enrollNextId() {
+  scanner.stop();
+
+  uint16_t id = 0;
+  while (id <= MAX_FINGERPRINT_ID && fingerprint.checkFingerprintExists(id)) {
+    id++;
+  }
+
+  if (id > MAX_FINGERPRINT_ID) {
+    Serial.println("Library is full");
+  } else {
+    Serial.println("Enrolling ID " + String(id) + ", place the finger 6 times...");
+    bool success = fingerprint.autoEnroll(id);
+    journal.logEnroll(id, success, success ? FP_ERROR_SUCCESS : fingerprint.getLastError());
+    Serial.println(success ? "Enrolled ID " + String(id) :
+                   "Enrollment failed: " + fingerprint.getErrorString(fingerprint.getLastError()));
+  }
+
+  journal.flush();
+  scanner.start();
+}
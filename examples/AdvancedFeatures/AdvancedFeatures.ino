@@ -18,9 +18,11 @@
 */
 
 #include <FPM383F.h>
+#include <FPM383FLed.h>
 
 // Initialize sensor (RX pin 2, TX pin 4, Touch interrupt pin 3)
 FPM383F fingerprint(2, 4, 3);
+FPM383FLed led(fingerprint);
 
 void setup() {
   Serial.begin(115200);
@@ -98,6 +100,9 @@ void ledControlDemo() {
   Serial.println("\n=== LED CONTROL PATTERNS ===");
   Serial.println("Demonstrating various LED patterns...");
   
+  // The other demos call setLED() directly
+  led.invalidate();
+  
   // Basic colors
   Serial.println("1. Basic Colors:");
   
@@ -140,13 +145,11 @@ void ledControlDemo() {
   fingerprint.setLED(FP_LED_MODE_BLINK, FP_LED_GREEN, 20, 20, 5);
   delay(3000);
   
+  // Two colours cannot be blinked natively; the sequencer times the steps
   Serial.println("   Alternating Red/Blue");
-  for (int i = 0; i < 5; i++) {
-    fingerprint.setLED(FP_LED_MODE_ON, FP_LED_RED);
-    delay(300);
-    fingerprint.setLED(FP_LED_MODE_ON, FP_LED_BLUE);
-    delay(300);
-  }
+  uint8_t redBlue[] = {FP_LED_RED, FP_LED_BLUE};
+  led.cycle(redBlue, 2, 300, 5);
+  runLedEffect(3000);
   
   // PWM/Breathing patterns
   Serial.println("\n3. Breathing/PWM Patterns:");
@@ -167,16 +170,24 @@ void ledControlDemo() {
   Serial.println("\n4. Rainbow Effect:");
   uint8_t colors[] = {FP_LED_RED, FP_LED_RED_GREEN, FP_LED_GREEN, 
                      FP_LED_GREEN_BLUE, FP_LED_BLUE, FP_LED_RED_BLUE};
-  
-  for (int cycle = 0; cycle < 3; cycle++) {
-    for (int i = 0; i < 6; i++) {
-      fingerprint.setLED(FP_LED_MODE_ON, colors[i]);
-      delay(300);
-    }
-  }
+  led.cycle(colors, 6, 300, 3);
+  runLedEffect(5400);
   
   Serial.println("LED demonstration complete!");
-  fingerprint.setLED(FP_LED_MODE_ON, FP_LED_GREEN);
+  Serial.println("   Frames sent: " + String(led.getSentCount()) + ", coalesced: " + String(led.getCoalescedCount()));
+  led.solid(FP_LED_GREEN);
+  led.flush();
+}
+
+void runLedEffect(uint32_t duration) {
+  uint32_t start = millis();
+  while (millis() - start < duration) {
+    // Sends a frame only when the effect changes the LED
+    led.update();
+    delay(10);
+  }
+  // Wait for the last frame before the next blocking call
+  led.flush();
 }
 
 void powerManagementDemo() {
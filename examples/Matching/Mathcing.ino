@@ -14,9 +14,15 @@
 */
 
 #include <FPM383F.h>
+#include <FPM383FScanner.h>
+#include <FPM383FLed.h>
+#include <FPM383FScoreTracker.h>
 
 // Initialize sensor (RX pin 2, TX pin 4, Touch interrupt pin 3)
 FPM383F fingerprint(2, 4, 3);
+FPM383FScanner scanner(fingerprint);
+FPM383FLed led(fingerprint);
+FPM383FScoreTracker scores(fingerprint);
 
 // Statistics tracking
 struct MatchingStats {
@@ -36,6 +42,9 @@ void setup() {
   Serial.println("FPM383F Matching Example");
   Serial.println("========================");
   
+  // Record every match score per template
+  fingerprint.setScoreTracker(&scores);
+  
   // Initialize sensor
   if (fingerprint.begin()) {
     Serial.println("Sensor initialized successfully!");
@@ -191,48 +200,57 @@ void continuousMatchingMode() {
   Serial.println("Continuous matching mode activated.");
   Serial.println("Place fingers on sensor. Press any key to exit.");
   
-  fingerprint.setLED(FP_LED_MODE_PWM, FP_LED_BLUE, 100, 20, 30);
+  // Results are reported with the link idle, so the LED frame started below
+  // goes out first; the scanner re-arms right after it, so the next person
+  // can scan while the previous one walks through.
+  led.invalidate();
+  led.breathe(FP_LED_BLUE, 100, 20, 30);
+  scanner.resetStats();
+  scanner.start();
   
   while (!Serial.available()) {
-    // Check for finger presence
-    if (fingerprint.isFingerPresent()) {
-      Serial.println("\nFinger detected! Matching...");
-      
-      FingerprintMatchResult result = fingerprint.matchSync();
-      
+    uint8_t event = scanner.update();
+    
+    if (event == FP_SCAN_MATCH) {
+      FingerprintMatchResult result = scanner.getResult();
       stats.totalAttempts++;
-      
-      if (fingerprint.getLastError() == FP_ERROR_SUCCESS) {
-        if (result.matched) {
-          stats.successfulMatches++;
-          Serial.println("✓ Match: ID " + String(result.fingerprintId) + 
-                        ", Score: " + String(result.matchScore));
-          fingerprint.setLED(FP_LED_MODE_ON, FP_LED_GREEN);
-        } else {
-          stats.failedMatches++;
-          Serial.println("✗ No match found");
-          fingerprint.setLED(FP_LED_MODE_ON, FP_LED_RED);
-        }
-      } else {
-        stats.failedMatches++;
-        Serial.println("✗ Error: " + fingerprint.getErrorString(fingerprint.getLastError()));
-        fingerprint.setLED(FP_LED_MODE_BLINK, FP_LED_RED, 5, 5, 2);
-      }
-      
-      // Wait for finger removal
-      Serial.println("Remove finger...");
-      fingerprint.waitForFingerRemoval(5000);
-      delay(1000);
-      fingerprint.setLED(FP_LED_MODE_PWM, FP_LED_BLUE, 100, 20, 30);
+      stats.successfulMatches++;
+      stats.lastMatchedId = result.fingerprintId;
+      stats.lastMatchScore = result.matchScore;
+      Serial.println("✓ Match: ID " + String(result.fingerprintId) + 
+                    ", Score: " + String(result.matchScore));
+      led.blink(FP_LED_GREEN, 100, 100, 2);
+    } else if (event == FP_SCAN_NO_MATCH) {
+      stats.totalAttempts++;
+      stats.failedMatches++;
+      Serial.println("✗ No match found");
+      led.blink(FP_LED_RED, 100, 100, 2);
+    } else if (event == FP_SCAN_ERROR) {
+      stats.totalAttempts++;
+      stats.failedMatches++;
+      Serial.println("✗ Error: " + fingerprint.getErrorString(scanner.getLastError()));
     }
     
-    delay(100); // Small delay to prevent excessive polling
+    // Starts a frame only while the link is idle, so it never delays a match
+    // result the scanner is waiting for
+    led.update();
   }
   
+  // Complete the LED frame first so stop() can cancel the module's match
+  led.flush();
+  scanner.stop();
+  
   // Clear input buffer
   while (Serial.available()) Serial.read();
   
+  const FPM383FScanStats& scanStats = scanner.getStats();
   Serial.println("Exiting continuous mode.");
+  Serial.println("  Matches: " + String(scanStats.matches) + " (" + String(scanStats.duplicates) +
+                 " repeats suppressed)");
+  Serial.println("  Sustained rate: " + String(scanner.getMatchesPerMinute()) + " matches/min");
+  if (scanStats.scans > 0) {
+    Serial.println("  Average scan cycle: " + String(scanStats.totalCycleMs / scanStats.scans) + "ms");
+  }
   fingerprint.setLED(FP_LED_MODE_ON, FP_LED_BLUE);
 }
 
@@ -269,6 +287,7 @@ void matchingWithLearning() {
         delay(500);
         if (fingerprint.queryUpdateResult()) {
           Serial.println("  ✓ Template updated successfully!");
+          scores.forget(result.fingerprintId); // start a new score history
           fingerprint.setLED(FP_LED_MODE_BLINK, FP_LED_GREEN, 10, 10, 3);
         } else {
           Serial.println("  ⚠ Template update not needed or failed.");
@@ -347,6 +366,15 @@ void showStatistics() {
     Serial.println("Last Match Score: " + String(stats.lastMatchScore));
   }
   
+  // Per-template scores
+  Serial.println();
+  scores.printReport(Serial);
+  uint16_t degrading[8];
+  uint8_t degradingCount = scores.findDegrading(degrading, 8);
+  for (uint8_t i = 0; i < degradingCount; i++) {
+    Serial.println("Re-enroll or run self-learning (option 3) for ID " + String(degrading[i]));
+  }
+  
   // Current system status
   uint16_t templateCount = fingerprint.getTemplateCount();
   Serial.println("\nCurrent System Status:");
@@ -0,0 +1,151 @@
+/*
+  FPM383F Template Backup Example
+
+  This example backs up all enrolled templates to an SD card, restores
+  them to a (replacement) module, and benchmarks template transfer
+  throughput at each supported baudrate.
+
+  Requires module firmware with template upload/download support
+  (see FP_CMD_UPLOAD_TEMPLATE_* / FP_CMD_DOWNLOAD_TEMPLATE_* in FPM383FProtocol.h).
+
+  Hardware Connections:
+  - V_TOUCH: 3.3V
+  - TOUCHOUT: Digital Pin 3 (optional)
+  - VCC: 3.3V
+  - TX: Digital Pin 2
+  - RX: Digital Pin 4 (with 10kΩ pull-up)
+  - GND: GND
+  - SD card module: SPI, CS on Digital Pin 10
+*/
+
+#include <SD.h>
+#include <FPM383F.h>
+#include <FPM383FBackup.h>
+
+#define SD_CS_PIN 10
+#define BACKUP_FILE "/templates.fpb"
+#define BENCH_FILE "/bench.fpb"
+#define DEFAULT_BAUDRATE 57600
+
+// Initialize sensor (RX pin 2, TX pin 4, Touch interrupt pin 3)
+FPM383F fingerprint(2, 4, 3);
+FPM383FBackup templateBackup(fingerprint);
+
+const uint32_t baudrates[] = {9600, 19200, 38400, 57600, 115200};
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("FPM383F Template Backup Example");
+  Serial.println("===============================");
+
+  if (!SD.begin(SD_CS_PIN)) {
+    Serial.println("SD card initialization failed!");
+    while(1);
+  }
+
+  if (fingerprint.begin(DEFAULT_BAUDRATE)) {
+    Serial.println("Sensor initialized successfully!");
+    Serial.println("Enrolled fingerprints: " + String(fingerprint.getTemplateCount()));
+  } else {
+    Serial.println("Failed to initialize sensor!");
+    Serial.println("Error: " + fingerprint.getErrorString(fingerprint.getLastError()));
+    while(1);
+  }
+}
+
+void loop() {
+  Serial.println("\n=== TEMPLATE BACKUP MENU ===");
+  Serial.println("1 - Backup templates to SD");
+  Serial.println("2 - Restore templates from SD");
+  Serial.println("3 - Benchmark throughput per baudrate");
+  Serial.println("Enter your choice (1-3):");
+
+  while (!Serial.available());
+  char choice = Serial.read();
+  while (Serial.available()) Serial.read(); // Clear buffer
+
+  switch (choice) {
+    case '1':
+      backupTemplates(BACKUP_FILE);
+      break;
+    case '2':
+      restoreTemplates();
+      break;
+    case '3':
+      benchmarkBaudrates();
+      break;
+    default:
+      Serial.println("Invalid choice. Please select 1-3.");
+  }
+}
+
+void printStats() {
+  const FPM383FBackupStats& stats = templateBackup.getStats();
+  Serial.println("  Templates: " + String(stats.templates) + " (skipped " + String(stats.skipped) + ")");
+  Serial.println("  Bytes: " + String(stats.bytes) + " in " + String(stats.chunks) + " chunks, " +
+                 String(stats.retries) + " retries");
+  Serial.println("  Time: " + String(stats.elapsedMs) + "ms, " + String(templateBackup.getThroughput()) + " bytes/s");
+}
+
+bool backupTemplates(const char* path) {
+  Serial.println("\n--- Backup ---");
+
+  SD.remove(path);
+  File file = SD.open(path, FILE_WRITE);
+  if (!file) {
+    Serial.println("Cannot open " + String(path));
+    return false;
+  }
+
+  bool ok = templateBackup.backup(file, 0, 999);
+  file.close();
+
+  if (ok) {
+    Serial.println("Backup complete:");
+  } else {
+    Serial.println("Backup failed after ID " + String(templateBackup.getStats().lastId));
+    Serial.println("Error: " + fingerprint.getErrorString(templateBackup.getLastError()));
+  }
+  printStats();
+  return ok;
+}
+
+void restoreTemplates() {
+  Serial.println("\n--- Restore ---");
+
+  File file = SD.open(BACKUP_FILE);
+  if (!file) {
+    Serial.println("No backup found");
+    return;
+  }
+
+  bool ok = templateBackup.restore(file);
+  file.close();
+
+  if (ok) {
+    Serial.println("Restore complete:");
+  } else {
+    // Run the restore again with resumeFromId = lastId + 1 to continue
+    Serial.println("Restore failed after ID " + String(templateBackup.getStats().lastId));
+    Serial.println("Error: " + fingerprint.getErrorString(templateBackup.getLastError()));
+  }
+  printStats();
+}
+
+void benchmarkBaudrates() {
+  Serial.println("\n--- Throughput Benchmark ---");
+
+  for (uint8_t i = 0; i < sizeof(baudrates) / sizeof(baudrates[0]); i++) {
+    Serial.println("\nBaudrate " + String(baudrates[i]) + ":");
+
+    if (!fingerprint.setBaudrate(baudrates[i])) {
+      Serial.println("  Baudrate change failed");
+      continue;
+    }
+
+    backupTemplates(BENCH_FILE);
+  }
+
+  fingerprint.setBaudrate(DEFAULT_BAUDRATE);
+  SD.remove(BENCH_FILE);
+}
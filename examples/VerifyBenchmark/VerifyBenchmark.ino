@@ -0,0 +1,154 @@
+/*
+  FPM383F Verify Benchmark Example
+
+  This example compares 1:1 verification (verify) with 1:N search
+  (matchSync) for badge-plus-finger doors, where the claimed ID is
+  already known from the badge.
+
+  1:N search time grows with the number of enrolled templates, 1:1
+  verification should not. Run the benchmark, enroll more fingerprints
+  (option 2), and run it again; each run prints one CSV line so the
+  results can be plotted against the template count.
+
+  If the module firmware does not support 1:1 verification, verify()
+  falls back to a 1:N search and compares the matched ID, and the
+  benchmark reports the mode as "search".
+
+  Hardware Connections:
+  - V_TOUCH: 3.3V
+  - TOUCHOUT: Digital Pin 3 (optional)
+  - VCC: 3.3V
+  - TX: Digital Pin 2
+  - RX: Digital Pin 4 (with 10kΩ pull-up)
+  - GND: GND
+*/
+
+#include <FPM383F.h>
+
+#define BENCH_ROUNDS 5
+#define MAX_FINGERPRINT_ID 59
+
+// Initialize sensor (RX pin 2, TX pin 4, Touch interrupt pin 3)
+FPM383F fingerprint(2, 4, 3);
+
+struct LatencyStats {
+  uint32_t minMs;
+  uint32_t maxMs;
+  uint32_t totalMs;
+  uint8_t samples;
+  uint8_t correct;
+};
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("FPM383F Verify Benchmark Example");
+  Serial.println("================================");
+
+  if (fingerprint.begin()) {
+    Serial.println("Sensor initialized successfully!");
+    Serial.println("Enrolled fingerprints: " + String(fingerprint.getTemplateCount()));
+  } else {
+    Serial.println("Failed to initialize sensor!");
+    Serial.println("Error: " + fingerprint.getErrorString(fingerprint.getLastError()));
+    while(1);
+  }
+}
+
+void loop() {
+  Serial.println("\n=== VERIFY BENCHMARK MENU ===");
+  Serial.println("1 - Benchmark 1:1 verify vs 1:N search");
+  Serial.println("2 - Enroll a fingerprint into the next free ID");
+  Serial.println("Enter your choice (1-2):");
+
+  while (!Serial.available());
+  char choice = Serial.read();
+  while (Serial.available()) Serial.read(); // Clear buffer
+
+  switch (choice) {
+    case '1':
+      runBenchmark();
+      break;
+    case '2':
+      enrollNextId();
+      break;
+    default:
+      Serial.println("Invalid choice. Please select 1-2.");
+  }
+}
+
+uint16_t readId() {
+  while (!Serial.available());
+  uint16_t id = Serial.parseInt();
+  while (Serial.available()) Serial.read(); // Clear buffer
+  return id;
+}
+
+void addSample(LatencyStats& stats, uint32_t latency, bool correct) {
+  if (stats.samples == 0 || latency < stats.minMs) stats.minMs = latency;
+  if (latency > stats.maxMs) stats.maxMs = latency;
+  stats.totalMs += latency;
+  stats.samples++;
+  if (correct) stats.correct++;
+}
+
+void printStats(const char* name, LatencyStats& stats) {
+  if (stats.samples == 0) return;
+  Serial.println(String(name) + ": avg " + String(stats.totalMs / stats.samples) + "ms, min " +
+                 String(stats.minMs) + "ms, max " + String(stats.maxMs) + "ms, " +
+                 String(stats.correct) + "/" + String(stats.samples) + " accepted");
+}
+
+void runBenchmark() {
+  Serial.println("\n--- 1:1 vs 1:N Benchmark ---");
+  Serial.println("Enter the enrolled ID to claim:");
+  uint16_t claimedId = readId();
+
+  uint16_t templateCount = fingerprint.getTemplateCount();
+  LatencyStats verifyStats = {0, 0, 0, 0, 0};
+  LatencyStats searchStats = {0, 0, 0, 0, 0};
+
+  for (uint8_t round = 1; round <= BENCH_ROUNDS; round++) {
+    Serial.println("\nRound " + String(round) + "/" + String(BENCH_ROUNDS) + ": place finger for 1:1 verify...");
+    fingerprint.waitForFinger();
+    uint32_t start = millis();
+    FingerprintMatchResult result = fingerprint.verify(claimedId);
+    addSample(verifyStats, millis() - start, result.matched);
+    fingerprint.waitForFingerRemoval();
+
+    Serial.println("Place finger again for 1:N search...");
+    fingerprint.waitForFinger();
+    start = millis();
+    result = fingerprint.matchSync();
+    addSample(searchStats, millis() - start, result.matched && result.fingerprintId == claimedId);
+    fingerprint.waitForFingerRemoval();
+  }
+
+  const char* mode = fingerprint.getVerifyMode() == FP_VERIFY_NATIVE ? "native" : "search";
+  Serial.println("\nTemplates: " + String(templateCount) + ", verify mode: " + String(mode));
+  printStats("1:1 verify", verifyStats);
+  printStats("1:N search", searchStats);
+
+  // templates,verify mode,1:1 avg,1:N avg
+  Serial.println("CSV," + String(templateCount) + "," + String(mode) + "," +
+                 String(verifyStats.totalMs / BENCH_ROUNDS) + "," + String(searchStats.totalMs / BENCH_ROUNDS));
+}
+
+void enrollNextId() {
+  Serial.println("\n--- Enroll ---");
+
+  uint16_t id = 0;
+  while (id <= MAX_FINGERPRINT_ID && fingerprint.checkFingerprintExists(id)) {
+    id++;
+  }
+  if (id > MAX_FINGERPRINT_ID) {
+    Serial.println("Library is full");
+    return;
+  }
+
+  Serial.println("Enrolling ID " + String(id) + ", place the finger 6 times...");
+  if (fingerprint.autoEnroll(id)) {
+    Serial.println("Enrolled ID " + String(id) + ", templates: " + String(fingerprint.getTemplateCount()));
+  } else {
+    Serial.println("Enrollment failed: " + fingerprint.getErrorString(fingerprint.getLastError()));
+  }
+}
@@ -0,0 +1,151 @@
+// Decode throughput benchmark for FPM383FFrameDecoder.
+//
+//   ./fpm383f-decode-bench [recorded.bin ...]
+//
+// Measures MB/s and frames/s over synthesized response frames, random bytes
+// and noise with embedded frame headers, plus any recorded UART captures given
+// on the command line. The decoder's memory use is fixed (sizeof below), so
+// the per-byte cost is the only thing garbage input can influence.
+
+#include "FPM383FProtocol.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#define BENCH_STREAM_SIZE (16u * 1024u * 1024u)
+#define BENCH_ROUNDS 5
+
+static uint32_t rngState = 0x12345678;
+
+static uint8_t nextRandom() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return (uint8_t)rngState;
+}
+
+static double nowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// A response carries the 4-byte error code in front of the payload, so it can
+// be built with the request encoder.
+static void appendResponse(std::vector<uint8_t>& stream, uint8_t cmd1, uint8_t cmd2, uint16_t payloadLen) {
+  uint8_t data[FP_MAX_FRAME_DATA];
+  uint8_t frame[FP_FRAME_OVERHEAD + FP_MAX_FRAME_DATA];
+  uint16_t dataLen = 4 + payloadLen;
+
+  memset(data, 0, 4);
+  for (uint16_t i = 4; i < dataLen; i++) {
+    data[i] = nextRandom();
+  }
+  uint16_t frameLen = fpm383fEncodeFrame(frame, sizeof(frame), 0, cmd1, cmd2, data, dataLen);
+  stream.insert(stream.end(), frame, frame + frameLen);
+}
+
+static void buildValid(std::vector<uint8_t>& stream) {
+  static const uint16_t payloadSizes[] = {0, 3, 6, 16, 64, FP_MAX_FRAME_DATA - FP_RESPONSE_MIN_LENGTH};
+  size_t i = 0;
+  while (stream.size() < BENCH_STREAM_SIZE) {
+    appendResponse(stream, FP_CMD_FINGERPRINT_0, FP_CMD_MATCH_SYNC, payloadSizes[i++ % 6]);
+  }
+}
+
+static void buildRandom(std::vector<uint8_t>& stream) {
+  stream.resize(BENCH_STREAM_SIZE);
+  for (size_t i = 0; i < stream.size(); i++) {
+    stream[i] = nextRandom();
+  }
+}
+
+// Random bytes with frame headers (and frequently the first header byte)
+// injected, so the decoder keeps entering the length and body states
+static void buildNoisy(std::vector<uint8_t>& stream) {
+  static const uint8_t header[8] = {FP_FRAME_HEADER_0, FP_FRAME_HEADER_1, FP_FRAME_HEADER_2, FP_FRAME_HEADER_3,
+                                    FP_FRAME_HEADER_4, FP_FRAME_HEADER_5, FP_FRAME_HEADER_6, FP_FRAME_HEADER_7};
+  while (stream.size() < BENCH_STREAM_SIZE) {
+    uint8_t pick = nextRandom();
+    if (pick < 8) {
+      stream.insert(stream.end(), header, header + 8);
+    } else if (pick < 40) {
+      stream.push_back(FP_FRAME_HEADER_0);
+    } else if (pick < 44) {
+      appendResponse(stream, FP_CMD_MAINTENANCE_0, FP_CMD_HEARTBEAT, 0);
+    } else {
+      stream.push_back(nextRandom());
+    }
+  }
+}
+
+static bool loadFile(const char* path, std::vector<uint8_t>& stream) {
+  FILE* file = fopen(path, "rb");
+  if (!file) return false;
+
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    stream.insert(stream.end(), chunk, chunk + n);
+  }
+  fclose(file);
+  return true;
+}
+
+static void run(const char* name, const std::vector<uint8_t>& stream) {
+  FPM383FFrameDecoder decoder;
+  unsigned long frames = 0;
+  unsigned long errors = 0;
+  double best = 0;
+
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    decoder.reset();
+    frames = 0;
+    errors = 0;
+    double start = nowSeconds();
+    for (size_t i = 0; i < stream.size(); i++) {
+      FPM383FFrameDecoder::Status status = decoder.push(stream[i]);
+      if (status == FPM383FFrameDecoder::FRAME_READY) {
+        frames++;
+      } else if (status == FPM383FFrameDecoder::FRAME_ERROR) {
+        errors++;
+      }
+    }
+    double elapsed = nowSeconds() - start;
+    if (best == 0 || elapsed < best) best = elapsed;
+  }
+
+  printf("%-12s %10zu bytes %9.1f MB/s %12.0f frames/s %8lu frames %8lu errors\n", name, stream.size(),
+         stream.size() / best / 1e6, frames / best, frames, errors);
+}
+
+int main(int argc, char** argv) {
+  printf("sizeof(FPM383FFrameDecoder) = %zu bytes, FP_MAX_FRAME_DATA = %d\n\n", sizeof(FPM383FFrameDecoder),
+         FP_MAX_FRAME_DATA);
+
+  std::vector<uint8_t> stream;
+  buildValid(stream);
+  run("valid", stream);
+
+  stream.clear();
+  buildRandom(stream);
+  run("random", stream);
+
+  stream.clear();
+  buildNoisy(stream);
+  run("noisy", stream);
+
+  for (int i = 1; i < argc; i++) {
+    stream.clear();
+    if (!loadFile(argv[i], stream)) {
+      fprintf(stderr, "cannot open %s\n", argv[i]);
+      return 1;
+    }
+    run(argv[i], stream);
+  }
+  return 0;
+}
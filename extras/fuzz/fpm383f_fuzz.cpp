@@ -0,0 +1,83 @@
+// Fuzz target for the FPM383F frame decoder and typed response parsers.
+//
+// Built with clang's libFuzzer (make fuzz), or as a standalone corpus replayer
+// with any compiler (make fpm383f-fuzz-replay). Every input is pushed through
+// the decoder byte by byte; each decoded payload, and the raw input itself, is
+// fed to all response parsers. Out-of-bounds access is caught by
+// AddressSanitizer.
+
+#include "FPM383FProtocol.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static void runParsers(const uint8_t* data, uint16_t length) {
+  FingerprintMatchResult match;
+  FingerprintEnrollResult enroll;
+  uint16_t count;
+  bool flag;
+  char moduleId[17];
+  char tiny[4];
+
+  fpm383fParseMatchResult(data, length, &match);
+  fpm383fParseEnrollResult(data, length, &enroll);
+  fpm383fParseTemplateCount(data, length, &count);
+  fpm383fParseFlag(data, length, &flag);
+  fpm383fParseModuleId(data, length, moduleId, sizeof(moduleId));
+  fpm383fParseModuleId(data, length, tiny, sizeof(tiny));
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  static FPM383FFrameDecoder decoder;
+  decoder.reset();
+
+  for (size_t i = 0; i < size; i++) {
+    FPM383FFrameDecoder::Status status = decoder.push(data[i]);
+    if (status == FPM383FFrameDecoder::FRAME_READY) {
+      if (decoder.getPayloadLength() > FP_MAX_FRAME_DATA - FP_RESPONSE_MIN_LENGTH ||
+          decoder.getFrameLength() != FP_FRAME_OVERHEAD + FP_RESPONSE_MIN_LENGTH + decoder.getPayloadLength()) {
+        abort();
+      }
+      decoder.getCmd1();
+      decoder.getCmd2();
+      decoder.getErrorCode();
+      runParsers(decoder.getPayload(), decoder.getPayloadLength());
+    } else if (status == FPM383FFrameDecoder::FRAME_ERROR) {
+      uint32_t error = decoder.getDecodeError();
+      if (error != FP_ERROR_INVALID_DATA && error != FP_ERROR_INVALID_LENGTH) {
+        abort();
+      }
+    }
+  }
+
+  runParsers(data, size > 0xFFFF ? 0xFFFF : (uint16_t)size);
+  return 0;
+}
+
+#ifdef FPM383F_FUZZ_STANDALONE
+// Replays corpus files (or stdin) through the fuzz target
+int main(int argc, char** argv) {
+  static uint8_t input[1 << 20];
+
+  if (argc < 2) {
+    size_t size = fread(input, 1, sizeof(input), stdin);
+    LLVMFuzzerTestOneInput(input, size);
+    return 0;
+  }
+
+  for (int i = 1; i < argc; i++) {
+    FILE* file = fopen(argv[i], "rb");
+    if (!file) {
+      fprintf(stderr, "cannot open %s\n", argv[i]);
+      return 1;
+    }
+    size_t size = fread(input, 1, sizeof(input), file);
+    fclose(file);
+    LLVMFuzzerTestOneInput(input, size);
+  }
+  printf("replayed %d input(s)\n", argc - 1);
+  return 0;
+}
+#endif
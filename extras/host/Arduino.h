@@ -0,0 +1,108 @@
+// Minimal Arduino core for building the driver on a host. Only what the
+// library uses is provided; timing comes from FPM383FManualClock, so millis()
+// and delay() are plain counters.
+
+#ifndef FPM383F_HOST_ARDUINO_H
+#define FPM383F_HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define DEC 10
+#define HEX 16
+
+using std::min;
+using std::max;
+
+class String {
+public:
+  String(const char* text = "") : text(text) {}
+  String(const std::string& text) : text(text) {}
+  String(char c) : text(1, c) {}
+  String(int value, int base = DEC) { format(base == HEX ? "%x" : "%d", value); }
+  String(unsigned value, int base = DEC) { format(base == HEX ? "%x" : "%u", value); }
+  String(long value, int base = DEC) { format(base == HEX ? "%lx" : "%ld", value); }
+  String(unsigned long value, int base = DEC) { format(base == HEX ? "%lx" : "%lu", value); }
+  String(unsigned char value, int base = DEC) : String((unsigned)value, base) {}
+  String(double value, int decimals = 2) { char buffer[40]; snprintf(buffer, sizeof(buffer), "%.*f", decimals, value); text = buffer; }
+
+  String& operator+=(const String& other) { text += other.text; return *this; }
+  friend String operator+(const String& a, const String& b) { return String(a.text + b.text); }
+  friend String operator+(const char* a, const String& b) { return String(std::string(a) + b.text); }
+  unsigned length() const { return text.size(); }
+  const char* c_str() const { return text.c_str(); }
+
+private:
+  std::string text;
+
+  template <class T> void format(const char* pattern, T value) {
+    char buffer[40];
+    snprintf(buffer, sizeof(buffer), pattern, value);
+    text = buffer;
+  }
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t value) = 0;
+  virtual size_t write(const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++) write(data[i]);
+    return length;
+  }
+
+  size_t print(const String& text) { return write((const uint8_t*)text.c_str(), text.length()); }
+  size_t print(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int value, int base = DEC) { return print(String(value, base)); }
+  size_t print(unsigned value, int base = DEC) { return print(String(value, base)); }
+  size_t print(long value, int base = DEC) { return print(String(value, base)); }
+  size_t print(unsigned long value, int base = DEC) { return print(String(value, base)); }
+  size_t print(double value, int decimals = 2) { return print(String(value, decimals)); }
+  template <class T> size_t println(T value) { return print(value) + print("\n"); }
+  template <class T> size_t println(T value, int format) { return print(value, format) + print("\n"); }
+  size_t println() { return print("\n"); }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() {}
+
+  size_t readBytes(uint8_t* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length && available()) buffer[count++] = read();
+    return count;
+  }
+};
+
+class HostSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  int available() { return 0; }
+  int read() { return -1; }
+  int peek() { return -1; }
+  size_t write(uint8_t value) { return fputc(value, stdout) == EOF ? 0 : 1; }
+  using Print::write;
+};
+
+extern HostSerial Serial;
+
+unsigned long millis();
+void delay(unsigned long ms);
+void yield();
+void pinMode(int pin, int mode);
+int digitalRead(int pin);
+void digitalWrite(int pin, int value);
+
+#endif
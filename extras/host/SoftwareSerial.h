@@ -0,0 +1,21 @@
+// Host stand-in for SoftwareSerial; host checks pass their own Stream to the
+// driver instead.
+
+#ifndef FPM383F_HOST_SOFTWARE_SERIAL_H
+#define FPM383F_HOST_SOFTWARE_SERIAL_H
+
+#include "Arduino.h"
+
+class SoftwareSerial : public Stream {
+public:
+  SoftwareSerial(int, int) {}
+  void begin(unsigned long) {}
+  void end() {}
+  int available() { return 0; }
+  int read() { return -1; }
+  int peek() { return -1; }
+  size_t write(uint8_t) { return 1; }
+  using Print::write;
+};
+
+#endif
@@ -0,0 +1,25 @@
+#include "Arduino.h"
+
+HostSerial Serial;
+
+static unsigned long hostMillis;
+
+unsigned long millis() {
+  return hostMillis;
+}
+
+void delay(unsigned long ms) {
+  hostMillis += ms;
+}
+
+void yield() {
+  hostMillis++;
+}
+
+void pinMode(int, int) {}
+
+int digitalRead(int) {
+  return LOW;
+}
+
+void digitalWrite(int, int) {}
@@ -0,0 +1,194 @@
+// Runs the driver's timeouts in virtual time with FPM383FManualClock, starting
+// just before the 32-bit millisecond wraparound. Against a silent module every
+// wait must end after exactly its timeout; against a scripted module an answer
+// is accepted up to the last millisecond of its own deadline and never after.
+
+#include "FPM383F.h"
+#include "scripted_module.h"
+
+#define START_TIME ((uint32_t)0xFFFFFF00)
+
+static int failures = 0;
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+      failures++; \
+    } \
+  } while (0)
+
+// Accepts commands and never responds
+class SilentModule : public Stream {
+public:
+  int available() { return 0; }
+  int read() { return -1; }
+  int peek() { return -1; }
+  size_t write(uint8_t) { return 1; }
+  using Print::write;
+};
+
+static void checkResponseTimeout() {
+  SilentModule module;
+  FPM383F driver(module);
+  FPM383FManualClock clock(START_TIME);
+  driver.setClock(clock);
+
+  CHECK(!driver.heartbeat());
+  CHECK(driver.getLastError() == FP_ERROR_TIMEOUT);
+  CHECK(clock.now() < START_TIME);  // wrapped
+  CHECK(clock.now() - START_TIME == FP_RESPONSE_TIMEOUT);
+}
+
+static void checkAutoEnrollTimeout() {
+  SilentModule module;
+  FPM383F driver(module);
+  FPM383FManualClock clock(START_TIME);
+  driver.setClock(clock);
+
+  CHECK(!driver.autoEnroll(1));
+  CHECK(clock.now() - START_TIME == FP_AUTO_ENROLL_TIMEOUT);
+}
+
+static void checkRequestTimeout() {
+  SilentModule module;
+  FPM383F driver(module);
+  FPM383FManualClock clock(START_TIME + 200);
+  driver.setClock(clock);
+
+  CHECK(driver.beginRequest(FP_CMD_MAINTENANCE_0, FP_CMD_HEARTBEAT, nullptr, 0, 300));
+  uint32_t start = clock.now();
+  while (driver.pollRequest() == FP_REQUEST_PENDING) {
+    clock.advance(1);
+  }
+  CHECK(driver.pollRequest() == FP_REQUEST_FAILED);
+  CHECK(driver.getLastError() == FP_ERROR_TIMEOUT);
+  CHECK(clock.now() - start == 300);
+}
+
+// Every enrollment step gets its own response deadline, so a module that is
+// slow on each step is fine as long as no single answer is late
+static void checkEnrollStepDeadlines() {
+  FPM383FManualClock clock(START_TIME);
+  const uint8_t steps = 3;
+  uint8_t queries = 0;
+  ScriptedModule module(clock, [&](const ScriptedCommand& command) {
+    if (command.cmd2 != FP_CMD_QUERY_ENROLL) {
+      return ScriptedModule::reply(FP_ERROR_SUCCESS, {}, FP_RESPONSE_TIMEOUT - 1);
+    }
+    queries++;
+    if (queries > steps) {
+      return ScriptedModule::reply(FP_ERROR_SUCCESS, {0, 1, 100}, FP_RESPONSE_TIMEOUT + 1);
+    }
+    return ScriptedModule::reply(FP_ERROR_SUCCESS, {0, 1, (uint8_t)(queries * 100 / steps)}, FP_RESPONSE_TIMEOUT - 1);
+  });
+  FPM383F driver(module);
+  driver.setClock(clock);
+
+  FingerprintEnrollResult result = {0, 0, false};
+  for (uint8_t step = 1; step <= steps; step++) {
+    CHECK(driver.startEnrollment(step));
+    result = driver.queryEnrollmentResult();
+    CHECK(result.progress == step * 100 / steps);
+  }
+  CHECK(result.completed);
+  CHECK(clock.now() - START_TIME == 2 * steps * (FP_RESPONSE_TIMEOUT - 1));
+
+  // One answer past its own deadline fails that step after exactly the timeout
+  uint32_t start = clock.now();
+  result = driver.queryEnrollmentResult();
+  CHECK(!result.completed && result.progress == 0);
+  CHECK(driver.getLastError() == FP_ERROR_TIMEOUT);
+  CHECK(clock.now() - start == FP_RESPONSE_TIMEOUT);
+  CHECK(module.commands.size() == 2 * steps + 1);
+}
+
+static FingerprintMatchResult matchAnsweredAfter(uint32_t delayMs, uint32_t* elapsed, uint32_t* error) {
+  FPM383FManualClock clock(START_TIME);
+  ScriptedModule module(clock, [&](const ScriptedCommand&) {
+    return ScriptedModule::reply(FP_ERROR_SUCCESS, {0, 0, 80, 0, 0, 7}, delayMs);
+  });
+  FPM383F driver(module);
+  driver.setClock(clock);
+
+  FingerprintMatchResult result = driver.matchSync();
+  *elapsed = clock.now() - START_TIME;
+  *error = driver.getLastError();
+  return result;
+}
+
+static void checkMatchAroundTimeout() {
+  uint32_t elapsed, error;
+
+  FingerprintMatchResult result = matchAnsweredAfter(FP_RESPONSE_TIMEOUT - 1, &elapsed, &error);
+  CHECK(result.matched && result.fingerprintId == 7 && result.matchScore == 80);
+  CHECK(error == FP_ERROR_SUCCESS);
+  CHECK(elapsed == FP_RESPONSE_TIMEOUT - 1);
+
+  result = matchAnsweredAfter(FP_RESPONSE_TIMEOUT + 1, &elapsed, &error);
+  CHECK(!result.matched);
+  CHECK(error == FP_ERROR_TIMEOUT);
+  CHECK(elapsed == FP_RESPONSE_TIMEOUT);
+}
+
+// The module keeps reporting progress, then goes quiet less than one response
+// timeout before the enrollment deadline: the last wait is clamped to what is
+// left of the deadline instead of running a full FP_RESPONSE_TIMEOUT past it
+static bool autoEnrollCompletedAfter(uint32_t delayMs, uint32_t* elapsed) {
+  FPM383FManualClock clock(START_TIME);
+  ScriptedModule* self = nullptr;
+  ScriptedModule module(clock, [&](const ScriptedCommand& command) {
+    uint8_t count = 1;
+    for (uint32_t at = 1000; at <= FP_AUTO_ENROLL_TIMEOUT - 3000; at += 1000, count++) {
+      self->queue(command.cmd1, command.cmd2, ScriptedModule::reply(FP_ERROR_SUCCESS, {count, 0, 1, 50}, at));
+    }
+    return ScriptedModule::reply(FP_ERROR_SUCCESS, {0xFF, 0, 1, 100}, delayMs);
+  });
+  self = &module;
+  FPM383F driver(module);
+  driver.setClock(clock);
+
+  bool completed = driver.autoEnroll(1);
+  *elapsed = clock.now() - START_TIME;
+  return completed;
+}
+
+static void checkAutoEnrollDeadlineClamp() {
+  uint32_t elapsed;
+
+  CHECK(autoEnrollCompletedAfter(FP_AUTO_ENROLL_TIMEOUT - 1, &elapsed));
+  CHECK(elapsed == FP_AUTO_ENROLL_TIMEOUT - 1);
+
+  CHECK(!autoEnrollCompletedAfter(FP_AUTO_ENROLL_TIMEOUT + 1, &elapsed));
+  CHECK(elapsed == FP_AUTO_ENROLL_TIMEOUT);
+}
+
+// With the circuit open nothing is sent and no call waits
+static void checkFailFast() {
+  SilentModule module;
+  FPM383F driver(module);
+  FPM383FManualClock clock(START_TIME);
+  driver.setClock(clock);
+  driver.setFailFast(true);
+
+  CHECK(!driver.heartbeat());
+  CHECK(!driver.autoEnroll(1));
+  CHECK(driver.getLastError() == FP_ERROR_CIRCUIT_OPEN);
+  CHECK(!driver.waitForFinger(1000));
+  CHECK(!driver.waitForFingerRemoval(1000));
+  CHECK(driver.getLastError() == FP_ERROR_CIRCUIT_OPEN);
+  CHECK(clock.now() == START_TIME);
+}
+
+int main() {
+  checkResponseTimeout();
+  checkAutoEnrollTimeout();
+  checkRequestTimeout();
+  checkEnrollStepDeadlines();
+  checkMatchAroundTimeout();
+  checkAutoEnrollDeadlineClamp();
+  checkFailFast();
+
+  printf("%s: %d failure(s)\n", failures ? "FAILED" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,175 @@
+// Runs FPM383FJournal on FPM383FMemoryJournalStorage (4 KiB, 512-byte erase
+// blocks, so 256 slots of which a block holds 32) through the ring wrap, a
+// reboot and cursor reads, including the state where the last page of an
+// erase block is full in RAM and not yet written. Error codes, including the
+// driver's own, must read back unchanged.
+
+#include "FPM383FJournal.h"
+
+#define STORAGE_SIZE 4096
+#define ERASE_SIZE 512
+#define SLOT_COUNT (STORAGE_SIZE / FP_JOURNAL_RECORD_SIZE)
+
+static int failures = 0;
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+      failures++; \
+    } \
+  } while (0)
+
+// Accepts commands and never responds; the journal only uses the clock
+class SilentModule : public Stream {
+public:
+  int available() { return 0; }
+  int read() { return -1; }
+  int peek() { return -1; }
+  size_t write(uint8_t) { return 1; }
+  using Print::write;
+};
+
+static uint8_t buffer[STORAGE_SIZE];
+
+static void logEvents(FPM383FJournal& journal, FPM383FManualClock& clock, uint32_t count, bool update) {
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t sequence = journal.getNextSequence();
+    CHECK(journal.log(FP_JOURNAL_MATCH, sequence % 60, 50 + sequence % 50, FP_ERROR_SUCCESS));
+    clock.advance(10);
+    if (update) CHECK(journal.update());
+  }
+}
+
+// Reads everything after cursor in batches of five; the events must continue
+// the sequence (or start at the oldest event) without gaps and end at the
+// newest one
+static uint32_t readAll(FPM383FJournal& journal, FPM383FJournalCursor& cursor) {
+  FPM383FJournalEvent events[5];
+  uint32_t total = 0;
+  uint32_t expected = max(cursor.sequence, journal.getOldestSequence());
+  uint32_t passes = 0;
+  uint16_t count;
+
+  while ((count = journal.read(cursor, events, 5)) > 0 && passes++ < SLOT_COUNT) {
+    for (uint16_t i = 0; i < count; i++) {
+      CHECK(events[i].sequence == expected);
+      CHECK(events[i].type == FP_JOURNAL_MATCH);
+      CHECK(events[i].fingerprintId == events[i].sequence % 60);
+      expected = events[i].sequence + 1;
+    }
+    total += count;
+  }
+  CHECK(cursor.sequence == journal.getNextSequence());
+  return total;
+}
+
+static void checkFullPageInRam() {
+  SilentModule module;
+  FPM383F driver(module);
+  FPM383FManualClock clock;
+  driver.setClock(clock);
+  FPM383FMemoryJournalStorage storage(buffer, STORAGE_SIZE, ERASE_SIZE);
+  FPM383FJournal journal(driver, storage);
+  CHECK(journal.begin());
+
+  // Every slot used, the last page only in RAM
+  logEvents(journal, clock, SLOT_COUNT - FP_JOURNAL_RECORDS_PER_PAGE, true);
+  logEvents(journal, clock, FP_JOURNAL_RECORDS_PER_PAGE, false);
+  CHECK(journal.getPendingCount() == FP_JOURNAL_RECORDS_PER_PAGE);
+
+  FPM383FJournalCursor cursor = journal.getOldestCursor();
+  CHECK(cursor.sequence == 0);
+  CHECK(readAll(journal, cursor) == SLOT_COUNT);
+
+  // Writing it starts the first block again and drops its records
+  CHECK(journal.update());
+  CHECK(journal.getPendingCount() == 0);
+  logEvents(journal, clock, 1, true);
+  CHECK(journal.getOldestSequence() == ERASE_SIZE / FP_JOURNAL_RECORD_SIZE);
+  cursor = journal.getOldestCursor();
+  CHECK(readAll(journal, cursor) == SLOT_COUNT - ERASE_SIZE / FP_JOURNAL_RECORD_SIZE + 1);
+}
+
+static void checkWrapAndReboot() {
+  SilentModule module;
+  FPM383F driver(module);
+  FPM383FManualClock clock;
+  driver.setClock(clock);
+  FPM383FMemoryJournalStorage storage(buffer, STORAGE_SIZE, ERASE_SIZE);
+
+  FPM383FJournalCursor cursor;
+  uint32_t nextSequence;
+  uint32_t oldestSequence;
+  {
+    FPM383FJournal journal(driver, storage);
+    CHECK(journal.begin());
+    logEvents(journal, clock, 1000, true);
+    CHECK(journal.getNextSequence() == 1000);
+    CHECK(journal.getOldestSequence() > 1000 - SLOT_COUNT);
+
+    cursor = journal.getOldestCursor();
+    CHECK(readAll(journal, cursor) == 1000 - journal.getOldestSequence());
+
+    // Half a page pending at power loss is lost; the rest survives
+    logEvents(journal, clock, 3, true);
+    CHECK(journal.flush());
+    logEvents(journal, clock, 2, true);
+    CHECK(journal.getPendingCount() == 2);
+    nextSequence = journal.getNextSequence() - 2;
+    oldestSequence = journal.getOldestSequence();
+  }
+
+  FPM383FJournal journal(driver, storage);
+  CHECK(journal.begin());
+  CHECK(journal.getNextSequence() == nextSequence);
+  CHECK(journal.getOldestSequence() == oldestSequence);
+
+  // A cursor persisted before the reboot resumes after its last event
+  CHECK(readAll(journal, cursor) == 3);
+
+  // Logging continues in the partially written page
+  logEvents(journal, clock, 40, true);
+  CHECK(journal.flush());
+  CHECK(readAll(journal, cursor) == 40);
+
+  // A cursor from before the oldest record restarts at the oldest one
+  FPM383FJournalCursor stale = {0, 0};
+  CHECK(readAll(journal, stale) == journal.getNextSequence() - journal.getOldestSequence());
+}
+
+static void checkErrorCodes() {
+  SilentModule module;
+  FPM383F driver(module);
+  FPM383FManualClock clock;
+  driver.setClock(clock);
+  FPM383FMemoryJournalStorage storage(buffer, STORAGE_SIZE, ERASE_SIZE);
+  FPM383FJournal journal(driver, storage);
+  CHECK(journal.begin());
+
+  const uint32_t codes[] = {FP_ERROR_SUCCESS, FP_ERROR_TIMEOUT, FP_ERROR_SMALL_AREA, 0xFEFF,
+                            FP_ERROR_CIRCUIT_OPEN, FP_ERROR_CIRCUIT_OPEN + 1};
+  const uint8_t codeCount = sizeof(codes) / sizeof(codes[0]);
+  for (uint8_t i = 0; i < codeCount; i++) {
+    CHECK(journal.log(FP_JOURNAL_ERROR, 0, 0, codes[i]));
+  }
+  CHECK(journal.log(FP_JOURNAL_ERROR, 0, 0, 0x12345678));
+  CHECK(journal.flush());
+
+  FPM383FJournalEvent events[FP_JOURNAL_RECORDS_PER_PAGE];
+  FPM383FJournalCursor cursor = journal.getOldestCursor();
+  CHECK(journal.read(cursor, events, FP_JOURNAL_RECORDS_PER_PAGE) == codeCount + 1);
+  for (uint8_t i = 0; i < codeCount; i++) {
+    CHECK(events[i].errorCode == codes[i]);
+  }
+  CHECK(events[codeCount].errorCode == 0xFFFF);  // does not fit
+}
+
+int main() {
+  checkFullPageInRam();
+  checkWrapAndReboot();
+  checkErrorCodes();
+
+  printf("%s: %d failure(s)\n", failures ? "FAILED" : "OK", failures);
+  return failures ? 1 : 0;
+}
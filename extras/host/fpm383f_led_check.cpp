@@ -0,0 +1,109 @@
+// Runs FPM383FLed against a module that rejects the first SET_LED frame. The
+// requested state must be sent again by a later update(), or replaced by a
+// request made while the failed frame was in flight.
+
+#include "FPM383FLed.h"
+#include "scripted_module.h"
+
+#include <memory>
+
+static int failures = 0;
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+      failures++; \
+    } \
+  } while (0)
+
+static int ledFrames(const ScriptedModule& module, uint8_t color) {
+  int count = 0;
+  for (size_t i = 0; i < module.commands.size(); i++) {
+    const ScriptedCommand& command = module.commands[i];
+    if (command.cmd2 == FP_CMD_SET_LED && command.data.size() == 5 && command.data[1] == color) {
+      count++;
+    }
+  }
+  return count;
+}
+
+// Fails the first SET_LED frame with errorCode, or leaves it unanswered
+static ScriptedModule::Handler failOnce(uint32_t errorCode, bool silent) {
+  std::shared_ptr<int> frames(new int(0));
+  return [=](const ScriptedCommand& command) {
+    if (command.cmd2 == FP_CMD_SET_LED && (*frames)++ == 0) {
+      return silent ? ScriptedModule::silence() : ScriptedModule::reply(errorCode);
+    }
+    return ScriptedModule::reply();
+  };
+}
+
+static void runUntilIdle(FPM383FLed& led, FPM383FManualClock& clock) {
+  for (int i = 0; i < 2 * FP_RESPONSE_TIMEOUT && led.isPending(); i++) {
+    led.update();
+    clock.advance(1);
+  }
+}
+
+static void checkRejectedFrameIsResent() {
+  FPM383FManualClock clock;
+  ScriptedModule module(clock, failOnce(FP_ERROR_HARDWARE_ERROR, false));
+  FPM383F driver(module);
+  driver.setClock(clock);
+  FPM383FLed led(driver);
+
+  led.solid(FP_LED_RED);
+  CHECK(led.update());     // frame sent
+  CHECK(!led.update());    // rejected
+  CHECK(led.getLastError() == FP_ERROR_HARDWARE_ERROR);
+  CHECK(led.isPending());
+
+  runUntilIdle(led, clock);
+  CHECK(!led.isPending());
+  CHECK(ledFrames(module, FP_LED_RED) == 2);
+  CHECK(led.getLastError() == FP_ERROR_SUCCESS);
+
+  // Now applied: the same request is not sent a third time
+  led.solid(FP_LED_RED);
+  runUntilIdle(led, clock);
+  CHECK(ledFrames(module, FP_LED_RED) == 2);
+}
+
+static void checkUnansweredFrameIsResent() {
+  FPM383FManualClock clock;
+  ScriptedModule module(clock, failOnce(FP_ERROR_SUCCESS, true));
+  FPM383F driver(module);
+  driver.setClock(clock);
+  FPM383FLed led(driver);
+
+  led.solid(FP_LED_BLUE);
+  runUntilIdle(led, clock);
+  CHECK(!led.isPending());
+  CHECK(ledFrames(module, FP_LED_BLUE) == 2);
+}
+
+static void checkNewerRequestWins() {
+  FPM383FManualClock clock;
+  ScriptedModule module(clock, failOnce(FP_ERROR_HARDWARE_ERROR, false));
+  FPM383F driver(module);
+  driver.setClock(clock);
+  FPM383FLed led(driver);
+
+  led.solid(FP_LED_RED);
+  CHECK(led.update());
+  led.solid(FP_LED_GREEN);  // while the red frame is in flight
+  runUntilIdle(led, clock);
+  CHECK(ledFrames(module, FP_LED_RED) == 1);
+  CHECK(ledFrames(module, FP_LED_GREEN) == 1);
+  CHECK(!led.isPending());
+}
+
+int main() {
+  checkRejectedFrameIsResent();
+  checkUnansweredFrameIsResent();
+  checkNewerRequestWins();
+
+  printf("%s: %d failure(s)\n", failures ? "FAILED" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,119 @@
+// Module stand-in for host checks. Decodes the command frames the driver
+// writes and answers them through a handler; an answer becomes readable once
+// the virtual clock has advanced by the handler's delay, so checks can place
+// a response just before or just after a deadline.
+
+#ifndef FPM383F_HOST_SCRIPTED_MODULE_H
+#define FPM383F_HOST_SCRIPTED_MODULE_H
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "FPM383F.h"
+
+struct ScriptedCommand {
+  uint8_t cmd1;
+  uint8_t cmd2;
+  std::vector<uint8_t> data;
+};
+
+struct ScriptedReply {
+  bool send;                   // false: the module never answers this command
+  uint32_t errorCode;
+  std::vector<uint8_t> data;
+  uint32_t delayMs;            // virtual time before the answer is readable
+};
+
+class ScriptedModule : public Stream {
+public:
+  typedef std::function<ScriptedReply(const ScriptedCommand&)> Handler;
+
+  ScriptedModule(FPM383FClock& clock, Handler handler) : clock(clock), handler(handler) {}
+
+  std::vector<ScriptedCommand> commands;
+
+  static ScriptedReply reply(uint32_t errorCode = FP_ERROR_SUCCESS, std::vector<uint8_t> data = std::vector<uint8_t>(),
+                             uint32_t delayMs = 0) {
+    ScriptedReply result = {true, errorCode, data, delayMs};
+    return result;
+  }
+
+  static ScriptedReply silence() {
+    ScriptedReply result = {false, FP_ERROR_SUCCESS, std::vector<uint8_t>(), 0};
+    return result;
+  }
+
+  // Queues an extra response to cmd1/cmd2 without a command, e.g. the
+  // progress frames of an auto enrollment
+  void queue(uint8_t cmd1, uint8_t cmd2, const ScriptedReply& answer) {
+    std::vector<uint8_t> response = {0, 0, 0, 0, cmd1, cmd2,
+                                     (uint8_t)(answer.errorCode >> 24), (uint8_t)(answer.errorCode >> 16),
+                                     (uint8_t)(answer.errorCode >> 8), (uint8_t)answer.errorCode};
+    response.insert(response.end(), answer.data.begin(), answer.data.end());
+    response.push_back(fpm383fChecksum(response.data(), response.size()));
+
+    uint16_t responseLength = response.size();
+    Frame frame;
+    frame.readyAt = clock.now() + answer.delayMs;
+    frame.bytes = {FP_FRAME_HEADER_0, FP_FRAME_HEADER_1, FP_FRAME_HEADER_2, FP_FRAME_HEADER_3,
+                   FP_FRAME_HEADER_4, FP_FRAME_HEADER_5, FP_FRAME_HEADER_6, FP_FRAME_HEADER_7,
+                   (uint8_t)(responseLength >> 8), (uint8_t)responseLength, fpm383fFrameChecksum(responseLength)};
+    frame.bytes.insert(frame.bytes.end(), response.begin(), response.end());
+    pending.push_back(frame);
+  }
+
+  int available() { return ready() ? (int)pending.front().bytes.size() - (int)offset : 0; }
+  int read() {
+    if (!ready()) return -1;
+    uint8_t value = pending.front().bytes[offset++];
+    if (offset == pending.front().bytes.size()) {
+      pending.pop_front();
+      offset = 0;
+    }
+    return value;
+  }
+  int peek() { return ready() ? pending.front().bytes[offset] : -1; }
+
+  size_t write(uint8_t value) {
+    incoming.push_back(value);
+    if (incoming.size() >= (size_t)FP_FRAME_OVERHEAD) {
+      uint16_t length = (incoming[8] << 8) | incoming[9];
+      if (incoming.size() == (size_t)FP_FRAME_OVERHEAD + length) {
+        handleCommand();
+        incoming.clear();
+      }
+    }
+    return 1;
+  }
+  using Print::write;
+
+private:
+  struct Frame {
+    uint32_t readyAt;
+    std::vector<uint8_t> bytes;
+  };
+
+  FPM383FClock& clock;
+  Handler handler;
+  std::vector<uint8_t> incoming;
+  std::deque<Frame> pending;
+  size_t offset = 0;
+
+  bool ready() { return !pending.empty() && (int32_t)(clock.now() - pending.front().readyAt) >= 0; }
+
+  void handleCommand() {
+    // Application data: password (4), cmd (2), data, checksum (1)
+    const uint8_t* app = &incoming[FP_FRAME_OVERHEAD];
+    uint16_t length = incoming.size() - FP_FRAME_OVERHEAD;
+    ScriptedCommand command = {app[4], app[5], std::vector<uint8_t>(app + 6, app + length - 1)};
+    commands.push_back(command);
+
+    ScriptedReply answer = handler(command);
+    if (answer.send) {
+      queue(command.cmd1, command.cmd2, answer);
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,535 @@
+// Host-side fleet provisioning tool for FPM383F modules.
+//
+// Opens every serial port given on the command line, applies the same
+// declarative configuration to all modules in parallel from a single poll()
+// event loop with non-blocking I/O, verifies each module with a heartbeat and
+// getModuleId, and reports per-module, per-step timing.
+//
+// Frames are built and parsed with the library's portable protocol code
+// (src/FPM383FProtocol.cpp).
+
+#include "FPM383FProtocol.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#define DEFAULT_TIMEOUT_MS 2000
+#define DEFAULT_RETRIES 2
+#define BAUDRATE_SWITCH_DELAY_MS 100  // same settle time the Arduino driver uses
+
+struct Config {
+  uint32_t password = 0;
+  bool setPassword = false;
+  uint32_t newPassword = 0;
+  uint32_t baudrate = 57600;
+  bool setBaudrate = false;
+  uint32_t newBaudrate = 0;
+  int enrollCount = -1;
+  bool setPolicy = false;
+  uint32_t policy = 0;
+  bool setLed = false;
+  uint8_t led[5] = {0, 0, 0, 0, 0};
+  int sleepMode = -1;
+  uint32_t timeoutMs = DEFAULT_TIMEOUT_MS;
+  int retries = DEFAULT_RETRIES;
+};
+
+enum StepKind {
+  STEP_COMMAND,
+  STEP_SET_PASSWORD,
+  STEP_SET_BAUDRATE,
+  STEP_MODULE_ID,
+  STEP_VERIFY_MODULE_ID,
+  STEP_SLEEP
+};
+
+struct Step {
+  const char* name;
+  StepKind kind;
+  uint8_t cmd1;
+  uint8_t cmd2;
+  std::vector<uint8_t> data;
+};
+
+struct StepTiming {
+  const char* name;
+  uint32_t elapsedMs;
+  int attempts;
+};
+
+struct Module {
+  std::string path;
+  int fd = -1;
+  uint32_t password = 0;
+  size_t step = 0;
+  int attempts = 0;
+  uint64_t stepStart = 0;
+  uint64_t deadline = 0;
+  uint64_t resumeAt = 0;        // non-zero while waiting for a baudrate switch to settle
+  uint64_t startTime = 0;
+  uint64_t endTime = 0;
+  bool done = false;
+  bool failed = false;
+  std::string error;
+  std::string moduleId;
+  std::vector<StepTiming> timings;
+  FPM383FFrameDecoder decoder;
+};
+
+static uint64_t nowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static speed_t toSpeed(uint32_t baudrate) {
+  switch (baudrate) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    default: return 0;
+  }
+}
+
+static bool configurePort(int fd, uint32_t baudrate) {
+  struct termios tio;
+  speed_t speed = toSpeed(baudrate);
+  if (!speed || tcgetattr(fd, &tio) != 0) return false;
+
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+
+  return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+static void putU32(std::vector<uint8_t>& out, uint32_t value) {
+  out.push_back((value >> 24) & 0xFF);
+  out.push_back((value >> 16) & 0xFF);
+  out.push_back((value >> 8) & 0xFF);
+  out.push_back(value & 0xFF);
+}
+
+static std::string trim(const std::string& s) {
+  size_t start = s.find_first_not_of(" \t\r\n");
+  size_t end = s.find_last_not_of(" \t\r\n");
+  return start == std::string::npos ? "" : s.substr(start, end - start + 1);
+}
+
+static bool parseNumber(const std::string& s, uint32_t* value) {
+  char* end = nullptr;
+  errno = 0;
+  unsigned long v = strtoul(s.c_str(), &end, 0);
+  if (errno || end == s.c_str() || *end != '\0' || v > 0xFFFFFFFFUL) return false;
+  *value = (uint32_t)v;
+  return true;
+}
+
+static bool loadConfig(const char* path, Config* config) {
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+    return false;
+  }
+
+  char line[256];
+  int lineNo = 0;
+  bool ok = true;
+
+  while (ok && fgets(line, sizeof(line), file)) {
+    lineNo++;
+    std::string text(line);
+    size_t hash = text.find('#');
+    if (hash != std::string::npos) text.erase(hash);
+    text = trim(text);
+    if (text.empty()) continue;
+
+    size_t eq = text.find('=');
+    if (eq == std::string::npos) {
+      ok = false;
+      break;
+    }
+
+    std::string key = trim(text.substr(0, eq));
+    std::string value = trim(text.substr(eq + 1));
+    uint32_t n = 0;
+
+    if (key == "led") {
+      // mode,color,param1,param2,param3
+      size_t pos = 0;
+      for (int i = 0; i < 5 && ok; i++) {
+        size_t comma = value.find(',', pos);
+        std::string part = trim(value.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos));
+        ok = parseNumber(part, &n) && n <= 0xFF && (i == 4 || comma != std::string::npos);
+        config->led[i] = n;
+        pos = comma + 1;
+      }
+      config->setLed = true;
+      continue;
+    }
+
+    if (!parseNumber(value, &n)) {
+      ok = false;
+    } else if (key == "password") {
+      config->password = n;
+    } else if (key == "new_password") {
+      config->setPassword = true;
+      config->newPassword = n;
+    } else if (key == "baudrate") {
+      config->baudrate = n;
+      ok = toSpeed(n) != 0;
+    } else if (key == "new_baudrate") {
+      config->setBaudrate = true;
+      config->newBaudrate = n;
+      ok = toSpeed(n) != 0;
+    } else if (key == "enroll_count") {
+      config->enrollCount = n;
+      ok = n >= 1 && n <= 6;
+    } else if (key == "policy") {
+      config->setPolicy = true;
+      config->policy = n;
+    } else if (key == "sleep_mode") {
+      config->sleepMode = n;
+      ok = n <= 0xFF;
+    } else if (key == "timeout_ms") {
+      config->timeoutMs = n;
+    } else if (key == "retries") {
+      config->retries = n;
+    } else {
+      ok = false;
+    }
+  }
+
+  if (!ok) {
+    fprintf(stderr, "%s:%d: invalid configuration line\n", path, lineNo);
+  }
+
+  fclose(file);
+  return ok;
+}
+
+static std::vector<Step> buildPlan(const Config& config) {
+  std::vector<Step> plan;
+
+  plan.push_back({"heartbeat", STEP_COMMAND, FP_CMD_MAINTENANCE_0, FP_CMD_HEARTBEAT, {}});
+  plan.push_back({"module_id", STEP_MODULE_ID, FP_CMD_MAINTENANCE_0, FP_CMD_GET_MODULE_ID, {}});
+
+  if (config.enrollCount > 0) {
+    plan.push_back({"enroll_count", STEP_COMMAND, FP_CMD_SYSTEM_0, FP_CMD_SET_ENROLL_COUNT,
+                    {(uint8_t)config.enrollCount}});
+  }
+  if (config.setPolicy) {
+    Step step = {"policy", STEP_COMMAND, FP_CMD_SYSTEM_0, FP_CMD_SET_POLICY, {}};
+    putU32(step.data, config.policy);
+    plan.push_back(step);
+  }
+  if (config.setLed) {
+    plan.push_back({"led", STEP_COMMAND, FP_CMD_SYSTEM_0, FP_CMD_SET_LED,
+                    std::vector<uint8_t>(config.led, config.led + 5)});
+  }
+
+  // Password and baudrate change how every later frame is sent, so they go last
+  if (config.setPassword) {
+    Step step = {"password", STEP_SET_PASSWORD, FP_CMD_SYSTEM_0, FP_CMD_SET_PASSWORD, {}};
+    putU32(step.data, config.newPassword);
+    plan.push_back(step);
+  }
+  if (config.setBaudrate) {
+    Step step = {"baudrate", STEP_SET_BAUDRATE, FP_CMD_MAINTENANCE_0, FP_CMD_SET_BAUDRATE, {}};
+    putU32(step.data, config.newBaudrate);
+    plan.push_back(step);
+  }
+
+  plan.push_back({"verify_heartbeat", STEP_COMMAND, FP_CMD_MAINTENANCE_0, FP_CMD_HEARTBEAT, {}});
+  plan.push_back({"verify_module_id", STEP_VERIFY_MODULE_ID, FP_CMD_MAINTENANCE_0, FP_CMD_GET_MODULE_ID, {}});
+
+  // The module stops answering once asleep
+  if (config.sleepMode >= 0) {
+    plan.push_back({"sleep_mode", STEP_SLEEP, FP_CMD_SYSTEM_0, FP_CMD_SET_SLEEP_MODE, {(uint8_t)config.sleepMode}});
+  }
+
+  return plan;
+}
+
+static void finish(Module& module, bool failed, const std::string& error) {
+  module.done = true;
+  module.failed = failed;
+  module.error = error;
+  module.endTime = nowMs();
+}
+
+static void sendStep(Module& module, const Step& step, const Config& config) {
+  uint8_t frame[FP_FRAME_OVERHEAD + 7 + 16];
+  uint16_t len = fpm383fEncodeFrame(frame, sizeof(frame), module.password, step.cmd1, step.cmd2,
+                                    step.data.empty() ? nullptr : step.data.data(), step.data.size());
+
+  // Frames are tiny compared with the kernel TTY buffer, so a short write means the port is broken
+  tcflush(module.fd, TCIFLUSH);
+  module.decoder.reset();
+  if (write(module.fd, frame, len) != len) {
+    finish(module, true, std::string(step.name) + ": write failed: " + strerror(errno));
+    return;
+  }
+
+  module.attempts++;
+  module.deadline = nowMs() + config.timeoutMs;
+}
+
+static void startStep(Module& module, const std::vector<Step>& plan, const Config& config) {
+  if (module.step >= plan.size()) {
+    finish(module, false, "");
+    return;
+  }
+
+  module.attempts = 0;
+  module.stepStart = nowMs();
+  sendStep(module, plan[module.step], config);
+}
+
+static void completeStep(Module& module, const std::vector<Step>& plan, const Config& config) {
+  const Step& step = plan[module.step];
+  module.timings.push_back({step.name, (uint32_t)(nowMs() - module.stepStart), module.attempts});
+  module.step++;
+  startStep(module, plan, config);
+}
+
+static void handleFrame(Module& module, const std::vector<Step>& plan, const Config& config) {
+  const Step& step = plan[module.step];
+  FPM383FFrameDecoder& decoder = module.decoder;
+
+  if (decoder.getCmd1() != step.cmd1 || decoder.getCmd2() != step.cmd2) {
+    return; // stale response from an earlier attempt
+  }
+
+  uint32_t errorCode = decoder.getErrorCode();
+  if (errorCode != FP_ERROR_SUCCESS) {
+    char text[64];
+    snprintf(text, sizeof(text), "%s: module error 0x%02X", step.name, (unsigned)errorCode);
+    finish(module, true, text);
+    return;
+  }
+
+  // Same parser as the firmware, from the portable protocol codec
+  char moduleId[17];
+  if ((step.kind == STEP_MODULE_ID || step.kind == STEP_VERIFY_MODULE_ID) &&
+      !fpm383fParseModuleId(decoder.getPayload(), decoder.getPayloadLength(), moduleId, sizeof(moduleId))) {
+    finish(module, true, std::string(step.name) + ": short response");
+    return;
+  }
+
+  switch (step.kind) {
+    case STEP_MODULE_ID:
+      module.moduleId = moduleId;
+      break;
+
+    case STEP_VERIFY_MODULE_ID:
+      if (module.moduleId != moduleId) {
+        finish(module, true, "verify_module_id: module ID changed");
+        return;
+      }
+      break;
+
+    case STEP_SET_PASSWORD:
+      module.password = config.newPassword;
+      break;
+
+    case STEP_SET_BAUDRATE:
+      // Switch the local port and give the module time to settle before the next frame
+      tcdrain(module.fd);
+      if (!configurePort(module.fd, config.newBaudrate)) {
+        finish(module, true, "baudrate: cannot reconfigure port");
+        return;
+      }
+      module.timings.push_back({step.name, (uint32_t)(nowMs() - module.stepStart), module.attempts});
+      module.step++;
+      module.resumeAt = nowMs() + BAUDRATE_SWITCH_DELAY_MS;
+      return;
+
+    default:
+      break;
+  }
+
+  completeStep(module, plan, config);
+}
+
+static void handleReadable(Module& module, const std::vector<Step>& plan, const Config& config, short revents) {
+  uint8_t buffer[256];
+  ssize_t n = 0;
+
+  while (!module.done && (n = read(module.fd, buffer, sizeof(buffer))) > 0) {
+    for (ssize_t i = 0; i < n && !module.done; i++) {
+      if (module.resumeAt) continue; // discard noise while the baudrate settles
+
+      FPM383FFrameDecoder::Status status = module.decoder.push(buffer[i]);
+      if (status == FPM383FFrameDecoder::FRAME_READY) {
+        size_t step = module.step;
+        handleFrame(module, plan, config);
+        if (module.step != step) break; // the rest of the buffer belongs to the previous step
+      }
+    }
+  }
+
+  if (module.done) return;
+
+  // The port reads 0 (end of file) once the adapter is unplugged; a hangup or
+  // error with nothing left to read means the same
+  bool wouldBlock = n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+  if (n == 0 || (wouldBlock && (revents & (POLLHUP | POLLERR | POLLNVAL)))) {
+    finish(module, true, "disconnected");
+  } else if (n < 0 && !wouldBlock) {
+    finish(module, true, std::string("read failed: ") + strerror(errno));
+  }
+}
+
+static void handleTimers(Module& module, const std::vector<Step>& plan, const Config& config, uint64_t now) {
+  if (module.done) return;
+
+  if (module.resumeAt) {
+    if (now >= module.resumeAt) {
+      module.resumeAt = 0;
+      startStep(module, plan, config);
+    }
+    return;
+  }
+
+  if (now < module.deadline) return;
+
+  const Step& step = plan[module.step];
+  if (step.kind == STEP_SLEEP) {
+    // Some firmware sleeps before acknowledging
+    completeStep(module, plan, config);
+  } else if (module.attempts <= config.retries) {
+    sendStep(module, step, config);
+  } else {
+    finish(module, true, std::string(step.name) + ": timeout");
+  }
+}
+
+static void report(const std::vector<Module>& modules, uint64_t totalMs) {
+  int failures = 0;
+
+  for (const Module& module : modules) {
+    printf("%-20s %-4s %6llums  id=%s\n", module.path.c_str(), module.failed ? "FAIL" : "OK",
+           (unsigned long long)(module.endTime - module.startTime),
+           module.moduleId.empty() ? "-" : module.moduleId.c_str());
+    for (const StepTiming& timing : module.timings) {
+      printf("    %-18s %6ums%s\n", timing.name, timing.elapsedMs, timing.attempts > 1 ? "  (retried)" : "");
+    }
+    if (module.failed) {
+      printf("    error: %s\n", module.error.c_str());
+      failures++;
+    }
+  }
+
+  printf("%zu modules, %d failed, %llums total\n", modules.size(), failures, (unsigned long long)totalMs);
+}
+
+static void usage(const char* name) {
+  fprintf(stderr, "usage: %s -c config [port...]\n", name);
+}
+
+int main(int argc, char** argv) {
+  const char* configPath = nullptr;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "c:h")) != -1) {
+    if (opt == 'c') {
+      configPath = optarg;
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  if (!configPath || optind >= argc) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  Config config;
+  if (!loadConfig(configPath, &config)) return 2;
+
+  std::vector<Step> plan = buildPlan(config);
+  std::vector<Module> modules(argc - optind);
+  uint64_t start = nowMs();
+
+  for (size_t i = 0; i < modules.size(); i++) {
+    Module& module = modules[i];
+    module.path = argv[optind + i];
+    module.password = config.password;
+    module.startTime = start;
+
+    module.fd = open(module.path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (module.fd < 0) {
+      finish(module, true, std::string("open failed: ") + strerror(errno));
+    } else if (!configurePort(module.fd, config.baudrate)) {
+      finish(module, true, "cannot configure port");
+    } else {
+      startStep(module, plan, config);
+    }
+  }
+
+  std::vector<struct pollfd> fds(modules.size());
+
+  for (;;) {
+    uint64_t now = nowMs();
+    uint64_t nextTimer = UINT64_MAX;
+    size_t active = 0;
+
+    for (size_t i = 0; i < modules.size(); i++) {
+      const Module& module = modules[i];
+      fds[i].fd = module.done ? -1 : module.fd;
+      fds[i].events = POLLIN;
+      fds[i].revents = 0;
+      if (module.done) continue;
+
+      active++;
+      uint64_t timer = module.resumeAt ? module.resumeAt : module.deadline;
+      if (timer < nextTimer) nextTimer = timer;
+    }
+
+    if (active == 0) break;
+
+    int waitMs = nextTimer > now ? (int)(nextTimer - now) : 0;
+    if (poll(fds.data(), fds.size(), waitMs) < 0 && errno != EINTR) {
+      perror("poll");
+      return 1;
+    }
+
+    now = nowMs();
+    for (size_t i = 0; i < modules.size(); i++) {
+      if (fds[i].revents & (POLLIN | POLLERR | POLLHUP | POLLNVAL)) {
+        handleReadable(modules[i], plan, config, fds[i].revents);
+      }
+      handleTimers(modules[i], plan, config, now);
+    }
+  }
+
+  for (Module& module : modules) {
+    if (module.fd >= 0) close(module.fd);
+  }
+
+  report(modules, nowMs() - start);
+
+  for (const Module& module : modules) {
+    if (module.failed) return 1;
+  }
+  return 0;
+}
@@ -1,11 +1,46 @@
 #include "FPM383F.h"
+#include "FPM383FScoreTracker.h"
+
+static FPM383FArduinoClock defaultClock;
+
+uint32_t FPM383FArduinoClock::now() {
+  return millis();
+}
+
+void FPM383FArduinoClock::sleep(uint32_t ms) {
+  if (ms) {
+    delay(ms);
+  } else {
+    yield();
+  }
+}
 
 FPM383F::FPM383F(int rxPin, int txPin, int touchPin) {
-  serial = new SoftwareSerial(rxPin, txPin);
+  softSerial = new SoftwareSerial(rxPin, txPin);
+  serial = softSerial;
+  init(touchPin);
+}
+
+FPM383F::FPM383F(Stream& stream, int touchPin) {
+  softSerial = nullptr;
+  serial = &stream;
+  init(touchPin);
+}
+
+void FPM383F::init(int touchPin) {
+  clock = &defaultClock;
   password = 0x00000000;
   this->touchPin = touchPin;
   lastError = FP_ERROR_SUCCESS;
   debugEnabled = false;
+  metricsPending = false;
+  requestState = FP_REQUEST_IDLE;
+  failFast = false;
+  consecutiveTimeouts = 0;
+  lastFrameTime = 0;
+  verifyMode = FP_VERIFY_AUTO;
+  scoreTracker = nullptr;
+  resetMetrics();
   
   if (touchPin >= 0) {
     pinMode(touchPin, INPUT);
@@ -13,193 +48,77 @@ FPM383F::FPM383F(int rxPin, int txPin, int touchPin) {
 }
 
 FPM383F::~FPM383F() {
-  delete serial;
+  delete softSerial;
 }
 
 bool FPM383F::begin(uint32_t baudrate) {
-  serial->begin(baudrate);
-  delay(200); // Wait for module initialization
+  // External streams are configured by their owner
+  if (softSerial) {
+    softSerial->begin(baudrate);
+  }
+  clock->sleep(200); // Wait for module initialization
   
   // Check if module is responsive
   return heartbeat();
 }
 
-uint8_t FPM383F::calculateChecksum(uint8_t* data, uint16_t length) {
-  int16_t sum = 0;
-  for (uint16_t i = 0; i < length; i++) {
-    sum += data[i];
-  }
-  return (uint8_t)((~sum) + 1);
-}
-
-uint8_t FPM383F::calculateFrameChecksum(uint16_t dataLength) {
-  uint8_t frameHeader[] = {FP_FRAME_HEADER_0, FP_FRAME_HEADER_1, FP_FRAME_HEADER_2, 
-                           FP_FRAME_HEADER_3, FP_FRAME_HEADER_4, FP_FRAME_HEADER_5, 
-                           FP_FRAME_HEADER_6, FP_FRAME_HEADER_7};
-  
-  int16_t sum = 0;
-  for (int i = 0; i < 8; i++) {
-    sum += frameHeader[i];
-  }
-  sum += (dataLength >> 8) & 0xFF;
-  sum += dataLength & 0xFF;
-  
-  return (uint8_t)((~sum) + 1);
-}
-
-void FPM383F::sendFrame(uint8_t cmd1, uint8_t cmd2, uint8_t* data, uint16_t dataLen) {
-  uint16_t totalLen = 7 + dataLen;
-  
-  // Send frame header
-  serial->write(FP_FRAME_HEADER_0);
-  serial->write(FP_FRAME_HEADER_1);
-  serial->write(FP_FRAME_HEADER_2);
-  serial->write(FP_FRAME_HEADER_3);
-  serial->write(FP_FRAME_HEADER_4);
-  serial->write(FP_FRAME_HEADER_5);
-  serial->write(FP_FRAME_HEADER_6);
-  serial->write(FP_FRAME_HEADER_7);
-  
-  // Send data length
-  serial->write((totalLen >> 8) & 0xFF);
-  serial->write(totalLen & 0xFF);
-  
-  // Send frame checksum
-  serial->write(calculateFrameChecksum(totalLen));
-  
-  // Prepare application data
-  uint8_t* appData = new uint8_t[totalLen];
-  uint16_t idx = 0;
-  
-  // Password
-  appData[idx++] = (password >> 24) & 0xFF;
-  appData[idx++] = (password >> 16) & 0xFF;
-  appData[idx++] = (password >> 8) & 0xFF;
-  appData[idx++] = password & 0xFF;
-  
-  // Command
-  appData[idx++] = cmd1;
-  appData[idx++] = cmd2;
-  
-  // Data
-  if (data && dataLen > 0) {
-    memcpy(&appData[idx], data, dataLen);
-    idx += dataLen;
+bool FPM383F::sendFrame(uint8_t cmd1, uint8_t cmd2, uint8_t* data, uint16_t dataLen) {
+  // Encode the whole frame into the fixed transmit buffer and send it in one
+  // write; frames the decoder could not accept either are refused
+  uint16_t frameLen = fpm383fEncodeFrame(txFrame, sizeof(txFrame), password, cmd1, cmd2, data, dataLen);
+  if (frameLen == 0) {
+    lastError = FP_ERROR_INVALID_LENGTH;
+    return false;
   }
   
-  // Calculate and add checksum
-  uint8_t checksum = calculateChecksum(appData, idx);
-  appData[idx++] = checksum;
-  
-  // Send application data
-  for (int i = 0; i < idx; i++) {
-    serial->write(appData[i]);
-  }
+  metricsBeginCall(cmd1, cmd2);
+  metrics.framesSent++;
+  metrics.bytesSent += frameLen;
   
-  delete[] appData;
+  serial->write(txFrame, frameLen);
   
   if (debugEnabled) {
     debugPrint("Sent command: " + String(cmd1, HEX) + " " + String(cmd2, HEX));
   }
+  return true;
 }
 
-bool FPM383F::receiveFrame(uint8_t* cmd1, uint8_t* cmd2, uint8_t* data, uint16_t maxDataLen, uint16_t* actualDataLen, uint32_t* errorCode) {
-  uint32_t timeout = millis() + 5000; // 5 second timeout
-  
-  // Wait for frame header
-  uint8_t headerIdx = 0;
-  uint8_t expectedHeader[] = {FP_FRAME_HEADER_0, FP_FRAME_HEADER_1, FP_FRAME_HEADER_2, 
-                             FP_FRAME_HEADER_3, FP_FRAME_HEADER_4, FP_FRAME_HEADER_5, 
-                             FP_FRAME_HEADER_6, FP_FRAME_HEADER_7};
-  
-  while (millis() < timeout && headerIdx < 8) {
-    if (serial->available()) {
-      uint8_t byte = serial->read();
-      if (byte == expectedHeader[headerIdx]) {
-        headerIdx++;
-      } else {
-        headerIdx = 0;
-        if (byte == expectedHeader[0]) headerIdx = 1;
-      }
-    }
+bool FPM383F::receiveFrame(uint8_t* cmd1, uint8_t* cmd2, uint8_t* data, uint16_t maxDataLen, uint16_t* actualDataLen, uint32_t* errorCode,
+                           uint32_t timeout) {
+  FPM383FDeadline deadline(clock->now(), timeout);
+  
+  decoder.reset();
+  FPM383FFrameDecoder::Status status = processIncoming();
+  while (status == FPM383FFrameDecoder::NEED_MORE && !deadline.expired(clock->now())) {
+    clock->sleep(0);
+    status = processIncoming();
   }
   
-  if (headerIdx < 8) {
-    lastError = FP_ERROR_TIMEOUT;
+  if (status == FPM383FFrameDecoder::FRAME_ERROR) {
     return false;
   }
   
-  // Read data length
-  while (millis() < timeout && serial->available() < 2) {
-    delay(1);
-  }
-  
-  if (serial->available() < 2) {
+  if (status != FPM383FFrameDecoder::FRAME_READY) {
+    metrics.timeouts++;
+    consecutiveTimeouts++;
     lastError = FP_ERROR_TIMEOUT;
     return false;
   }
   
-  uint16_t dataLength = (serial->read() << 8) | serial->read();
-  
-  // Read frame checksum
-  while (millis() < timeout && serial->available() < 1) {
-    delay(1);
-  }
-  
-  if (serial->available() < 1) {
-    lastError = FP_ERROR_TIMEOUT;
-    return false;
-  }
-  
-  uint8_t frameChecksum = serial->read();
-  
-  // Verify frame checksum
-  if (frameChecksum != calculateFrameChecksum(dataLength)) {
-    lastError = FP_ERROR_INVALID_DATA;
-    return false;
-  }
-  
-  // Read application data
-  while (millis() < timeout && serial->available() < dataLength) {
-    delay(1);
-  }
-  
-  if (serial->available() < dataLength) {
-    lastError = FP_ERROR_TIMEOUT;
-    return false;
-  }
-  
-  uint8_t* appData = new uint8_t[dataLength];
-  for (int i = 0; i < dataLength; i++) {
-    appData[i] = serial->read();
-  }
-  
-  // Verify application checksum
-  uint8_t receivedChecksum = appData[dataLength - 1];
-  uint8_t calculatedChecksum = calculateChecksum(appData, dataLength - 1);
-  
-  if (receivedChecksum != calculatedChecksum) {
-    delete[] appData;
-    lastError = FP_ERROR_INVALID_DATA;
-    return false;
-  }
-  
   // Parse response
-  uint32_t receivedPassword = (appData[0] << 24) | (appData[1] << 16) | (appData[2] << 8) | appData[3];
-  *cmd1 = appData[4];
-  *cmd2 = appData[5];
-  *errorCode = (appData[6] << 24) | (appData[7] << 16) | (appData[8] << 8) | appData[9];
+  *cmd1 = decoder.getCmd1();
+  *cmd2 = decoder.getCmd2();
+  *errorCode = decoder.getErrorCode();
   
   // Copy data
-  uint16_t responseDataLen = dataLength - 11; // 11 = 4 bytes password + 2 bytes cmd + 4 bytes error + 1 byte checksum
+  uint16_t responseDataLen = decoder.getPayloadLength();
   if (responseDataLen > 0 && data && maxDataLen > 0) {
     *actualDataLen = min(responseDataLen, maxDataLen);
-    memcpy(data, &appData[10], *actualDataLen);
+    memcpy(data, decoder.getPayload(), *actualDataLen);
   } else {
     *actualDataLen = 0;
   }
   
-  delete[] appData;
   lastError = *errorCode;
   
   if (debugEnabled) {
@@ -210,24 +129,60 @@ bool FPM383F::receiveFrame(uint8_t* cmd1, uint8_t* cmd2, uint8_t* data, uint16_t
   return true;
 }
 
+FPM383FFrameDecoder::Status FPM383F::processIncoming() {
+  // Stops at the first complete or rejected frame so no bytes of the next frame are consumed
+  while (serial->available()) {
+    FPM383FFrameDecoder::Status status = decoder.push(serial->read());
+    
+    if (status == FPM383FFrameDecoder::FRAME_READY) {
+      metrics.framesReceived++;
+      metrics.bytesReceived += decoder.getFrameLength();
+      consecutiveTimeouts = 0;
+      lastFrameTime = clock->now();
+      return status;
+    }
+    
+    if (status == FPM383FFrameDecoder::FRAME_ERROR) {
+      metrics.checksumErrors++;
+      lastError = decoder.getDecodeError();
+      return status;
+    }
+  }
+  
+  return FPM383FFrameDecoder::NEED_MORE;
+}
+
 bool FPM383F::sendCommand(uint8_t cmd1, uint8_t cmd2, uint8_t* data, uint16_t dataLen) {
-  sendFrame(cmd1, cmd2, data, dataLen);
-  return true;
+  if (failFast) {
+    lastError = FP_ERROR_CIRCUIT_OPEN;
+    return false;
+  }
+  return sendFrame(cmd1, cmd2, data, dataLen);
 }
 
-bool FPM383F::receiveResponse(uint8_t cmd1, uint8_t cmd2, uint8_t* data, uint16_t maxDataLen, uint16_t* actualDataLen, uint32_t* errorCode) {
+bool FPM383F::receiveResponse(uint8_t cmd1, uint8_t cmd2, uint8_t* data, uint16_t maxDataLen, uint16_t* actualDataLen, uint32_t* errorCode,
+                              uint32_t timeout) {
   uint8_t respCmd1, respCmd2;
   
-  if (!receiveFrame(&respCmd1, &respCmd2, data, maxDataLen, actualDataLen, errorCode)) {
+  if (failFast) {
+    lastError = FP_ERROR_CIRCUIT_OPEN;
+    return false;
+  }
+  
+  if (!receiveFrame(&respCmd1, &respCmd2, data, maxDataLen, actualDataLen, errorCode, timeout)) {
+    metricsEndCall(false, lastError);
     return false;
   }
   
   // Verify command match
   if (respCmd1 != cmd1 || respCmd2 != cmd2) {
+    metrics.unexpectedResponses++;
     lastError = FP_ERROR_INVALID_DATA;
+    metricsEndCall(false, lastError);
     return false;
   }
   
+  metricsEndCall(true, *errorCode);
   return true;
 }
 
@@ -310,10 +265,8 @@ FingerprintEnrollResult FPM383F::queryEnrollmentResult() {
     return result;
   }
   
-  if (errorCode == FP_ERROR_SUCCESS && dataLen >= 3) {
-    result.fingerprintId = (data[0] << 8) | data[1];
-    result.progress = data[2];
-    result.completed = (result.progress >= 100);
+  if (errorCode == FP_ERROR_SUCCESS) {
+    fpm383fParseEnrollResult(data, dataLen, &result);
   }
   
   return result;
@@ -356,17 +309,22 @@ bool FPM383F::autoEnroll(uint16_t fingerprintId, uint8_t enrollCount, bool waitF
   data[2] = (fingerprintId >> 8) & 0xFF;
   data[3] = fingerprintId & 0xFF;
   
-  sendCommand(FP_CMD_FINGERPRINT_0, FP_CMD_AUTO_ENROLL, data, 4);
+  if (!sendCommand(FP_CMD_FINGERPRINT_0, FP_CMD_AUTO_ENROLL, data, 4)) {
+    return false;
+  }
   
   // Auto enroll sends multiple responses
-  uint32_t timeout = millis() + 30000; // 30 second timeout
+  FPM383FDeadline deadline(clock->now(), FP_AUTO_ENROLL_TIMEOUT);
   
-  while (millis() < timeout) {
+  while (!deadline.expired(clock->now())) {
     uint32_t errorCode;
     uint16_t dataLen;
     uint8_t responseData[4];
     
-    if (receiveResponse(FP_CMD_FINGERPRINT_0, FP_CMD_AUTO_ENROLL, responseData, 4, &dataLen, &errorCode)) {
+    // Never wait past the enrollment deadline
+    uint32_t remaining = deadline.remaining(clock->now());
+    if (receiveResponse(FP_CMD_FINGERPRINT_0, FP_CMD_AUTO_ENROLL, responseData, 4, &dataLen, &errorCode,
+                        min(remaining, (uint32_t)FP_RESPONSE_TIMEOUT))) {
       if (errorCode != FP_ERROR_SUCCESS) {
         return false;
       }
@@ -380,9 +338,14 @@ bool FPM383F::autoEnroll(uint16_t fingerprintId, uint8_t enrollCount, bool waitF
           return true;
         }
       }
+    } else if (lastError == FP_ERROR_CIRCUIT_OPEN) {
+      return false;
     }
     
-    delay(100);
+    remaining = deadline.remaining(clock->now());
+    if (remaining > 0) {
+      clock->sleep(min(remaining, (uint32_t)100));
+    }
   }
   
   return false;
@@ -427,11 +390,8 @@ FingerprintMatchResult FPM383F::queryMatchResult() {
     return result;
   }
   
-  if (errorCode == FP_ERROR_SUCCESS && dataLen >= 6) {
-    result.matchScore = (data[1] << 8) | data[2];
-    result.fingerprintId = (data[4] << 8) | data[5];
-    // A match is found if score > 0 and ID is valid (not 65535)
-    result.matched = (result.matchScore > 0 && result.fingerprintId != 65535);
+  if (errorCode == FP_ERROR_SUCCESS && fpm383fParseMatchResult(data, dataLen, &result) && scoreTracker) {
+    scoreTracker->record(result);
   }
   
   return result;
@@ -440,6 +400,14 @@ FingerprintMatchResult FPM383F::queryMatchResult() {
 FingerprintMatchResult FPM383F::matchSync() {
   FingerprintMatchResult result = {false, 0, 0};
   
+  if (searchSync(&result) && scoreTracker) {
+    scoreTracker->record(result);
+  }
+  
+  return result;
+}
+
+bool FPM383F::searchSync(FingerprintMatchResult* result) {
   sendCommand(FP_CMD_FINGERPRINT_0, FP_CMD_MATCH_SYNC, nullptr, 0);
   
   uint32_t errorCode;
@@ -447,19 +415,84 @@ FingerprintMatchResult FPM383F::matchSync() {
   uint8_t data[6];
   
   if (!receiveResponse(FP_CMD_FINGERPRINT_0, FP_CMD_MATCH_SYNC, data, 6, &dataLen, &errorCode)) {
-    return result;
+    return false;
+  }
+  
+  return errorCode == FP_ERROR_SUCCESS && fpm383fParseMatchResult(data, dataLen, result);
+}
+
+FingerprintMatchResult FPM383F::verify(uint16_t fingerprintId) {
+  FingerprintMatchResult result = {false, 0, 0};
+  
+  if (verifyMode != FP_VERIFY_SEARCH) {
+    uint8_t request[2];
+    request[0] = (fingerprintId >> 8) & 0xFF;
+    request[1] = fingerprintId & 0xFF;
+    
+    sendCommand(FP_CMD_FINGERPRINT_0, FP_CMD_VERIFY_SYNC, request, 2);
+    
+    uint32_t errorCode;
+    uint16_t dataLen;
+    uint8_t data[6];
+    
+    if (!receiveResponse(FP_CMD_FINGERPRINT_0, FP_CMD_VERIFY_SYNC, data, 6, &dataLen, &errorCode)) {
+      return result;
+    }
+    
+    if (errorCode == FP_ERROR_SUCCESS && fpm383fParseMatchResult(data, dataLen, &result)) {
+      // Only a well-formed answer proves the firmware supports 1:1
+      verifyMode = FP_VERIFY_NATIVE;
+      result.matched = result.matched && result.fingerprintId == fingerprintId;
+      if (scoreTracker && result.matched) {
+        scoreTracker->recordMatch(fingerprintId, result.matchScore);
+      } else if (scoreTracker) {
+        scoreTracker->recordReject(fingerprintId);
+      }
+      return result;
+    }
+    
+    // Busy, timeouts and other transient errors decide nothing; retry in AUTO
+    bool rejected = errorCode == FP_ERROR_UNKNOWN_CMD || errorCode == FP_ERROR_INVALID_LENGTH ||
+                    errorCode == FP_ERROR_INVALID_DATA;
+    if (!rejected || verifyMode == FP_VERIFY_NATIVE) {
+      return result;
+    }
+    
+    // Firmware without 1:1 support: search the whole library instead
+    verifyMode = FP_VERIFY_SEARCH;
+    debugPrint("1:1 verify not supported, using 1:N search");
   }
   
-  if (errorCode == FP_ERROR_SUCCESS && dataLen >= 6) {
-    result.matchScore = (data[1] << 8) | data[2];
-    result.fingerprintId = (data[4] << 8) | data[5];
-    // A match is found if score > 0 and ID is valid (not 65535)
-    result.matched = (result.matchScore > 0 && result.fingerprintId != 65535);
+  // Recorded against the claimed ID, not whichever template the search found
+  if (!searchSync(&result)) {
+    return result;
+  }
+  result.matched = result.matched && result.fingerprintId == fingerprintId;
+  if (scoreTracker && result.matched) {
+    scoreTracker->recordMatch(fingerprintId, result.matchScore);
+  } else if (scoreTracker) {
+    scoreTracker->recordReject(fingerprintId);
   }
   
   return result;
 }
 
+void FPM383F::setVerifyMode(uint8_t mode) {
+  verifyMode = mode;
+}
+
+uint8_t FPM383F::getVerifyMode() {
+  return verifyMode;
+}
+
+void FPM383F::setScoreTracker(FPM383FScoreTracker* tracker) {
+  scoreTracker = tracker;
+}
+
+FPM383FScoreTracker* FPM383F::getScoreTracker() {
+  return scoreTracker;
+}
+
 bool FPM383F::deleteFingerprint(uint16_t fingerprintId) {
   uint8_t data[3];
   data[0] = 0x00; // Single fingerprint delete mode
@@ -524,11 +557,12 @@ bool FPM383F::checkFingerprintExists(uint16_t fingerprintId) {
     return false;
   }
   
-  if (errorCode == FP_ERROR_SUCCESS && dataLen >= 1) {
-    return (responseData[0] == 1);
+  bool exists = false;
+  if (errorCode == FP_ERROR_SUCCESS) {
+    fpm383fParseFlag(responseData, dataLen, &exists);
   }
   
-  return false;
+  return exists;
 }
 
 uint16_t FPM383F::getTemplateCount() {
@@ -542,11 +576,12 @@ uint16_t FPM383F::getTemplateCount() {
     return 0;
   }
   
-  if (errorCode == FP_ERROR_SUCCESS && dataLen >= 2) {
-    return (data[0] << 8) | data[1];
+  uint16_t count = 0;
+  if (errorCode == FP_ERROR_SUCCESS) {
+    fpm383fParseTemplateCount(data, dataLen, &count);
   }
   
-  return 0;
+  return count;
 }
 
 bool FPM383F::setSleepMode(uint8_t mode) {
@@ -614,14 +649,9 @@ String FPM383F::getModuleId() {
     return "";
   }
   
-  if (errorCode == FP_ERROR_SUCCESS && dataLen >= 16) {
-    String moduleId = "";
-    for (int i = 0; i < 16; i++) {
-      if (data[i] != 0) {
-        moduleId += (char)data[i];
-      }
-    }
-    return moduleId;
+  char moduleId[17];
+  if (errorCode == FP_ERROR_SUCCESS && fpm383fParseModuleId(data, dataLen, moduleId, sizeof(moduleId))) {
+    return String(moduleId);
   }
   
   return "";
@@ -644,10 +674,13 @@ bool FPM383F::setBaudrate(uint32_t baudrate) {
   }
   
   if (errorCode == FP_ERROR_SUCCESS) {
-    serial->end();
-    delay(100);
-    serial->begin(baudrate);
-    delay(100);
+    // External streams must be switched to the new baudrate by their owner
+    if (softSerial) {
+      softSerial->end();
+      clock->sleep(100);
+      softSerial->begin(baudrate);
+      clock->sleep(100);
+    }
     return true;
   }
   
@@ -669,34 +702,44 @@ bool FPM383F::isFingerPresent() {
     return false;
   }
   
-  if (errorCode == FP_ERROR_SUCCESS && dataLen >= 1) {
-    return (data[0] == 1);
+  bool present = false;
+  if (errorCode == FP_ERROR_SUCCESS) {
+    fpm383fParseFlag(data, dataLen, &present);
   }
   
-  return false;
+  return present;
 }
 
 bool FPM383F::waitForFinger(uint32_t timeout) {
-  uint32_t startTime = millis();
+  FPM383FDeadline deadline(clock->now(), timeout);
   
-  while (millis() - startTime < timeout) {
+  while (!deadline.expired(clock->now())) {
+    if (touchPin < 0 && failFast) {
+      lastError = FP_ERROR_CIRCUIT_OPEN;
+      return false;
+    }
     if (isFingerPresent()) {
       return true;
     }
-    delay(50);
+    clock->sleep(50);
   }
   
   return false;
 }
 
 bool FPM383F::waitForFingerRemoval(uint32_t timeout) {
-  uint32_t startTime = millis();
+  FPM383FDeadline deadline(clock->now(), timeout);
   
-  while (millis() - startTime < timeout) {
+  while (!deadline.expired(clock->now())) {
+    // An unanswered status query must not look like a lifted finger
+    if (touchPin < 0 && failFast) {
+      lastError = FP_ERROR_CIRCUIT_OPEN;
+      return false;
+    }
     if (!isFingerPresent()) {
       return true;
     }
-    delay(50);
+    clock->sleep(50);
   }
   
   return false;
@@ -732,6 +775,77 @@ bool FPM383F::queryUpdateResult() {
   return errorCode == FP_ERROR_SUCCESS;
 }
 
+bool FPM383F::beginRequest(uint8_t cmd1, uint8_t cmd2, uint8_t* data, uint16_t dataLen, uint32_t timeout) {
+  if (requestState == FP_REQUEST_PENDING) {
+    lastError = FP_ERROR_SYSTEM_BUSY;
+    return false;
+  }
+  
+  if (failFast) {
+    lastError = FP_ERROR_CIRCUIT_OPEN;
+    return false;
+  }
+  
+  decoder.reset();
+  if (!sendFrame(cmd1, cmd2, data, dataLen)) {
+    return false;
+  }
+  
+  requestCmd1 = cmd1;
+  requestCmd2 = cmd2;
+  requestDeadline = FPM383FDeadline(clock->now(), timeout);
+  requestState = FP_REQUEST_PENDING;
+  return true;
+}
+
+uint8_t FPM383F::pollRequest() {
+  if (requestState != FP_REQUEST_PENDING) {
+    return requestState;
+  }
+  
+  FPM383FFrameDecoder::Status status = processIncoming();
+  
+  if (status == FPM383FFrameDecoder::FRAME_READY) {
+    if (decoder.getCmd1() != requestCmd1 || decoder.getCmd2() != requestCmd2) {
+      metrics.unexpectedResponses++;
+      lastError = FP_ERROR_INVALID_DATA;
+      metricsEndCall(false, lastError);
+      requestState = FP_REQUEST_FAILED;
+    } else {
+      lastError = decoder.getErrorCode();
+      metricsEndCall(true, lastError);
+      requestState = FP_REQUEST_DONE;
+    }
+  } else if (status == FPM383FFrameDecoder::FRAME_ERROR) {
+    metricsEndCall(false, lastError);
+    requestState = FP_REQUEST_FAILED;
+  } else if (requestDeadline.expired(clock->now())) {
+    metrics.timeouts++;
+    consecutiveTimeouts++;
+    lastError = FP_ERROR_TIMEOUT;
+    metricsEndCall(false, lastError);
+    requestState = FP_REQUEST_FAILED;
+  }
+  
+  return requestState;
+}
+
+bool FPM383F::isRequestPending() {
+  return requestState == FP_REQUEST_PENDING;
+}
+
+uint32_t FPM383F::getResponseError() {
+  return requestState == FP_REQUEST_DONE ? decoder.getErrorCode() : lastError;
+}
+
+const uint8_t* FPM383F::getResponseData() {
+  return decoder.getPayload();
+}
+
+uint16_t FPM383F::getResponseLength() {
+  return requestState == FP_REQUEST_DONE ? decoder.getPayloadLength() : 0;
+}
+
 uint32_t FPM383F::getLastError() {
   return lastError;
 }
@@ -755,6 +869,7 @@ String FPM383F::getErrorString(uint32_t errorCode) {
     case FP_ERROR_POOR_IMAGE: return "Poor image quality";
     case FP_ERROR_DUPLICATE: return "Duplicate fingerprint";
     case FP_ERROR_SMALL_AREA: return "Finger area too small";
+    case FP_ERROR_CIRCUIT_OPEN: return "Module unavailable (recovering)";
     default: return "Unknown error: 0x" + String(errorCode, HEX);
   }
 }
@@ -763,8 +878,217 @@ void FPM383F::enableDebug(bool enable) {
   debugEnabled = enable;
 }
 
+void FPM383F::setClock(FPM383FClock& clock) {
+  this->clock = &clock;
+}
+
+FPM383FClock& FPM383F::getClock() {
+  return *clock;
+}
+
 void FPM383F::debugPrint(String message) {
   if (debugEnabled) {
     Serial.println("[FPM383F] " + message);
   }
 }
+
+void FPM383F::setFailFast(bool enable) {
+  failFast = enable;
+}
+
+bool FPM383F::isFailFast() {
+  return failFast;
+}
+
+uint16_t FPM383F::getConsecutiveTimeouts() {
+  return consecutiveTimeouts;
+}
+
+uint32_t FPM383F::getLastFrameTime() {
+  return lastFrameTime;
+}
+
+bool FPM383F::setLocalBaudrate(uint32_t baudrate) {
+  // External streams must be switched by their owner
+  if (!softSerial) {
+    return false;
+  }
+  softSerial->end();
+  softSerial->begin(baudrate);
+  return true;
+}
+
+void FPM383F::metricsBeginCall(uint8_t cmd1, uint8_t cmd2) {
+  metricsPending = true;
+  metricsCmd1 = cmd1;
+  metricsCmd2 = cmd2;
+  metricsStartTime = clock->now();
+}
+
+void FPM383F::metricsEndCall(bool transportOk, uint32_t errorCode) {
+  // Multi-response commands (auto enroll) only account for the first response
+  if (!metricsPending) return;
+  metricsPending = false;
+  
+  uint32_t latency = clock->now() - metricsStartTime;
+  
+  // Only status codes the module reported; transport failures reuse the same
+  // FP_ERROR_* values (a link timeout is not the module's capture timeout)
+  // and are counted per opcode below
+  if (transportOk) {
+    if (errorCode < FP_METRICS_ERROR_BUCKETS - 1) {
+      metrics.errorCounts[errorCode]++;
+    } else {
+      metrics.errorCounts[FP_METRICS_ERROR_BUCKETS - 1]++;
+    }
+  }
+  
+  // Find or allocate the opcode slot
+  FingerprintOpcodeMetrics* op = nullptr;
+  for (uint8_t i = 0; i < metrics.opcodeCount; i++) {
+    if (metrics.opcodes[i].cmd1 == metricsCmd1 && metrics.opcodes[i].cmd2 == metricsCmd2) {
+      op = &metrics.opcodes[i];
+      break;
+    }
+  }
+  
+  if (!op) {
+    if (metrics.opcodeCount >= FP_METRICS_MAX_OPCODES) {
+      metrics.untrackedCalls++;
+      return;
+    }
+    op = &metrics.opcodes[metrics.opcodeCount++];
+    memset(op, 0, sizeof(FingerprintOpcodeMetrics));
+    op->cmd1 = metricsCmd1;
+    op->cmd2 = metricsCmd2;
+  }
+  
+  op->calls++;
+  if (transportOk && errorCode == FP_ERROR_SUCCESS) {
+    op->successes++;
+  } else {
+    op->failures++;
+  }
+  if (!transportOk) {
+    op->transportErrors++;
+    if (errorCode == FP_ERROR_TIMEOUT) {
+      op->timeouts++;
+    }
+  }
+  
+  op->totalLatencyMs += latency;
+  if (latency > op->maxLatencyMs) {
+    op->maxLatencyMs = latency;
+  }
+  
+  // Bucket 0 holds <2ms, bucket i holds [2^i, 2^(i+1)) ms, the last bucket is open-ended
+  uint8_t bucket = 0;
+  for (uint32_t v = latency >> 1; v && bucket < FP_METRICS_LATENCY_BUCKETS - 1; v >>= 1) {
+    bucket++;
+  }
+  if (op->latencyHistogram[bucket] != 0xFFFF) {
+    op->latencyHistogram[bucket]++;
+  }
+}
+
+void FPM383F::getMetrics(FingerprintMetrics& snapshot) {
+  memcpy(&snapshot, &metrics, sizeof(FingerprintMetrics));
+}
+
+void FPM383F::resetMetrics() {
+  memset(&metrics, 0, sizeof(FingerprintMetrics));
+}
+
+size_t FPM383F::getMetricsExportSize() {
+  // version + 8 global counters + error counters + opcode count + per-opcode records
+  return 1 + 8 * 4 + FP_METRICS_ERROR_BUCKETS * 4 + 1 +
+         metrics.opcodeCount * (2 + 7 * 4 + FP_METRICS_LATENCY_BUCKETS * 2);
+}
+
+static uint8_t* putU32(uint8_t* p, uint32_t value) {
+  *p++ = (value >> 24) & 0xFF;
+  *p++ = (value >> 16) & 0xFF;
+  *p++ = (value >> 8) & 0xFF;
+  *p++ = value & 0xFF;
+  return p;
+}
+
+size_t FPM383F::exportMetrics(uint8_t* buffer, size_t bufferSize) {
+  size_t size = getMetricsExportSize();
+  if (!buffer || bufferSize < size) return 0;
+  
+  // All multi-byte values are big-endian, matching the module protocol
+  uint8_t* p = buffer;
+  *p++ = FP_METRICS_FORMAT_VERSION;
+  p = putU32(p, metrics.bytesSent);
+  p = putU32(p, metrics.bytesReceived);
+  p = putU32(p, metrics.framesSent);
+  p = putU32(p, metrics.framesReceived);
+  p = putU32(p, metrics.checksumErrors);
+  p = putU32(p, metrics.timeouts);
+  p = putU32(p, metrics.unexpectedResponses);
+  p = putU32(p, metrics.untrackedCalls);
+  for (uint8_t i = 0; i < FP_METRICS_ERROR_BUCKETS; i++) {
+    p = putU32(p, metrics.errorCounts[i]);
+  }
+  
+  *p++ = metrics.opcodeCount;
+  for (uint8_t i = 0; i < metrics.opcodeCount; i++) {
+    const FingerprintOpcodeMetrics& op = metrics.opcodes[i];
+    *p++ = op.cmd1;
+    *p++ = op.cmd2;
+    p = putU32(p, op.calls);
+    p = putU32(p, op.successes);
+    p = putU32(p, op.failures);
+    p = putU32(p, op.timeouts);
+    p = putU32(p, op.transportErrors);
+    p = putU32(p, op.totalLatencyMs);
+    p = putU32(p, op.maxLatencyMs);
+    for (uint8_t b = 0; b < FP_METRICS_LATENCY_BUCKETS; b++) {
+      *p++ = (op.latencyHistogram[b] >> 8) & 0xFF;
+      *p++ = op.latencyHistogram[b] & 0xFF;
+    }
+  }
+  
+  return size;
+}
+
+void FPM383F::printMetrics(Print& output) {
+  output.println("bytes tx=" + String(metrics.bytesSent) + " rx=" + String(metrics.bytesReceived));
+  output.println("frames tx=" + String(metrics.framesSent) + " rx=" + String(metrics.framesReceived));
+  output.println("checksum_errors=" + String(metrics.checksumErrors) +
+                 " timeouts=" + String(metrics.timeouts) +
+                 " unexpected=" + String(metrics.unexpectedResponses) +
+                 " untracked=" + String(metrics.untrackedCalls));
+  
+  output.print("errors");
+  for (uint8_t i = 0; i < FP_METRICS_ERROR_BUCKETS; i++) {
+    if (metrics.errorCounts[i] == 0) continue;
+    if (i == FP_METRICS_ERROR_BUCKETS - 1) {
+      output.print(" other=");
+    } else {
+      output.print(" 0x" + String(i, HEX) + "=");
+    }
+    output.print(String(metrics.errorCounts[i]));
+  }
+  output.println();
+  
+  for (uint8_t i = 0; i < metrics.opcodeCount; i++) {
+    const FingerprintOpcodeMetrics& op = metrics.opcodes[i];
+    uint32_t avg = op.calls ? op.totalLatencyMs / op.calls : 0;
+    output.print("op " + String(op.cmd1, HEX) + ":" + String(op.cmd2, HEX) +
+                 " calls=" + String(op.calls) +
+                 " ok=" + String(op.successes) +
+                 " fail=" + String(op.failures) +
+                 " timeouts=" + String(op.timeouts) +
+                 " transport=" + String(op.transportErrors) +
+                 " avg_ms=" + String(avg) +
+                 " max_ms=" + String(op.maxLatencyMs) +
+                 " hist=");
+    for (uint8_t b = 0; b < FP_METRICS_LATENCY_BUCKETS; b++) {
+      if (b) output.print(",");
+      output.print(String(op.latencyHistogram[b]));
+    }
+    output.println();
+  }
+}
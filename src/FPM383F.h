@@ -3,130 +3,123 @@
 
 #include <Arduino.h>
 #include <SoftwareSerial.h>
+#include "FPM383FProtocol.h"
+#include "FPM383FClock.h"
 
-// Frame header
-#define FP_FRAME_HEADER_0 0xF1
-#define FP_FRAME_HEADER_1 0x1F
-#define FP_FRAME_HEADER_2 0xE2
-#define FP_FRAME_HEADER_3 0x2E
-#define FP_FRAME_HEADER_4 0xB6
-#define FP_FRAME_HEADER_5 0x6B
-#define FP_FRAME_HEADER_6 0xA8
-#define FP_FRAME_HEADER_7 0x8A
+// Timeouts (ms)
+#define FP_RESPONSE_TIMEOUT 5000
+#define FP_AUTO_ENROLL_TIMEOUT 30000
 
-// Command categories
-#define FP_CMD_FINGERPRINT_0 0x01
-#define FP_CMD_SYSTEM_0 0x02
-#define FP_CMD_MAINTENANCE_0 0x03
+// Driver-side error codes (never sent by the module)
+#define FP_ERROR_CIRCUIT_OPEN 0x00010000  // fail-fast mode: the command was not sent
 
-// Fingerprint commands
-#define FP_CMD_ENROLL 0x11
-#define FP_CMD_QUERY_ENROLL 0x12
-#define FP_CMD_SAVE_TEMPLATE 0x13
-#define FP_CMD_QUERY_SAVE 0x14
-#define FP_CMD_CANCEL 0x15
-#define FP_CMD_UPDATE_FEATURE 0x16
-#define FP_CMD_QUERY_UPDATE 0x17
-#define FP_CMD_AUTO_ENROLL 0x18
-#define FP_CMD_MATCH 0x21
-#define FP_CMD_QUERY_MATCH 0x22
-#define FP_CMD_MATCH_SYNC 0x23
-#define FP_CMD_DELETE 0x31
-#define FP_CMD_QUERY_DELETE 0x32
-#define FP_CMD_CHECK_ID_EXIST 0x33
-#define FP_CMD_GET_STORAGE_INFO 0x34
-#define FP_CMD_CHECK_FINGER_STATUS 0x35
-#define FP_CMD_DELETE_SYNC 0x36
-#define FP_CMD_CONFIRM_ENROLL 0x41
-#define FP_CMD_QUERY_CONFIRM 0x42
-
-// System commands
-#define FP_CMD_SET_PASSWORD 0x01
-#define FP_CMD_RESET_MODULE 0x02
-#define FP_CMD_GET_TEMPLATE_COUNT 0x03
-#define FP_CMD_GET_GAIN 0x09
-#define FP_CMD_GET_THRESHOLD 0x0B
-#define FP_CMD_SET_SLEEP_MODE 0x0C
-#define FP_CMD_SET_ENROLL_COUNT 0x0D
-#define FP_CMD_SET_LED 0x0F
-#define FP_CMD_GET_POLICY 0xFB
-#define FP_CMD_SET_POLICY 0xFC
-
-// Maintenance commands
-#define FP_CMD_GET_MODULE_ID 0x01
-#define FP_CMD_HEARTBEAT 0x03
-#define FP_CMD_SET_BAUDRATE 0x04
-#define FP_CMD_SET_COMM_PASSWORD 0x05
-
-// Error codes
-#define FP_ERROR_SUCCESS 0x00000000
-#define FP_ERROR_UNKNOWN_CMD 0x00000001
-#define FP_ERROR_INVALID_LENGTH 0x00000002
-#define FP_ERROR_INVALID_DATA 0x00000003
-#define FP_ERROR_SYSTEM_BUSY 0x00000004
-#define FP_ERROR_NO_REQUEST 0x00000005
-#define FP_ERROR_SOFTWARE_ERROR 0x00000006
-#define FP_ERROR_HARDWARE_ERROR 0x00000007
-#define FP_ERROR_TIMEOUT 0x00000008
-#define FP_ERROR_EXTRACTION_ERROR 0x00000009
-#define FP_ERROR_TEMPLATE_EMPTY 0x0000000A
-#define FP_ERROR_STORAGE_FULL 0x0000000B
-#define FP_ERROR_WRITE_FAILED 0x0000000C
-#define FP_ERROR_READ_FAILED 0x0000000D
-#define FP_ERROR_POOR_IMAGE 0x0000000E
-#define FP_ERROR_DUPLICATE 0x0000000F
-#define FP_ERROR_SMALL_AREA 0x00000010
+// Metrics configuration
+#ifndef FP_METRICS_MAX_OPCODES
+#if defined(__AVR__)
+#define FP_METRICS_MAX_OPCODES 6
+#else
+#define FP_METRICS_MAX_OPCODES 24
+#endif
+#endif
+#define FP_METRICS_LATENCY_BUCKETS 12   // log2 buckets: <2ms, <4ms, ... , >=2048ms
+#define FP_METRICS_ERROR_BUCKETS 18     // module status FP_ERROR_SUCCESS..FP_ERROR_SMALL_AREA + other
+#define FP_METRICS_FORMAT_VERSION 0x02
 
-// LED colors
-#define FP_LED_OFF 0x00
-#define FP_LED_GREEN 0x01
-#define FP_LED_RED 0x02
-#define FP_LED_RED_GREEN 0x03
-#define FP_LED_BLUE 0x04
-#define FP_LED_RED_BLUE 0x05
-#define FP_LED_GREEN_BLUE 0x06
-#define FP_LED_ALL_COLORS 0x07
+// Verification modes
+#define FP_VERIFY_AUTO 0     // try FP_CMD_VERIFY_SYNC, switch to SEARCH if the firmware rejects it
+#define FP_VERIFY_NATIVE 1   // 1:1 on the module
+#define FP_VERIFY_SEARCH 2   // 1:N search, then compare the matched ID
 
-// LED control modes
-#define FP_LED_MODE_OFF 0x00
-#define FP_LED_MODE_ON 0x01
-#define FP_LED_MODE_AUTO 0x02
-#define FP_LED_MODE_PWM 0x03
-#define FP_LED_MODE_BLINK 0x04
+// Non-blocking request states
+#define FP_REQUEST_IDLE 0
+#define FP_REQUEST_PENDING 1
+#define FP_REQUEST_DONE 2
+#define FP_REQUEST_FAILED 3
 
-struct FingerprintMatchResult {
-  bool matched;
-  uint16_t fingerprintId;
-  uint16_t matchScore;
+struct FingerprintOpcodeMetrics {
+  uint8_t cmd1;
+  uint8_t cmd2;
+  uint32_t calls;
+  uint32_t successes;
+  uint32_t failures;
+  uint32_t timeouts;
+  uint32_t transportErrors;     // no usable response: timeouts, bad frames, unexpected responses
+  uint32_t totalLatencyMs;
+  uint32_t maxLatencyMs;
+  uint16_t latencyHistogram[FP_METRICS_LATENCY_BUCKETS];
 };
 
-struct FingerprintEnrollResult {
-  uint16_t fingerprintId;
-  uint8_t progress;
-  bool completed;
+struct FingerprintMetrics {
+  uint32_t bytesSent;
+  uint32_t bytesReceived;
+  uint32_t framesSent;
+  uint32_t framesReceived;
+  uint32_t checksumErrors;
+  uint32_t timeouts;
+  uint32_t unexpectedResponses;
+  uint32_t untrackedCalls;      // calls dropped because the opcode table was full
+  uint32_t errorCounts[FP_METRICS_ERROR_BUCKETS];  // status codes reported by the module
+  uint8_t opcodeCount;
+  FingerprintOpcodeMetrics opcodes[FP_METRICS_MAX_OPCODES];
 };
 
-struct FingerprintStorageInfo {
-  uint16_t totalCount;
-  uint8_t storageMap[64];
+class FPM383FScoreTracker;
+
+// Default clock backed by millis()/delay()
+class FPM383FArduinoClock : public FPM383FClock {
+public:
+  uint32_t now();
+  void sleep(uint32_t ms);
 };
 
 class FPM383F {
 private:
-  SoftwareSerial* serial;
+  Stream* serial;
+  SoftwareSerial* softSerial;
   uint32_t password;
   int touchPin;
+  FPM383FClock* clock;
+  
+  void init(int touchPin);
   
   // Communication functions
-  uint8_t calculateChecksum(uint8_t* data, uint16_t length);
-  uint8_t calculateFrameChecksum(uint16_t dataLength);
+  FPM383FFrameDecoder decoder;
+  uint8_t txFrame[FP_MAX_FRAME_DATA + FP_FRAME_OVERHEAD];
   bool sendCommand(uint8_t cmd1, uint8_t cmd2, uint8_t* data, uint16_t dataLen);
-  bool receiveResponse(uint8_t cmd1, uint8_t cmd2, uint8_t* data, uint16_t maxDataLen, uint16_t* actualDataLen, uint32_t* errorCode);
-  void sendFrame(uint8_t cmd1, uint8_t cmd2, uint8_t* data, uint16_t dataLen);
-  bool receiveFrame(uint8_t* cmd1, uint8_t* cmd2, uint8_t* data, uint16_t maxDataLen, uint16_t* actualDataLen, uint32_t* errorCode);
+  bool receiveResponse(uint8_t cmd1, uint8_t cmd2, uint8_t* data, uint16_t maxDataLen, uint16_t* actualDataLen, uint32_t* errorCode,
+                       uint32_t timeout = FP_RESPONSE_TIMEOUT);
+  bool sendFrame(uint8_t cmd1, uint8_t cmd2, uint8_t* data, uint16_t dataLen);
+  bool receiveFrame(uint8_t* cmd1, uint8_t* cmd2, uint8_t* data, uint16_t maxDataLen, uint16_t* actualDataLen, uint32_t* errorCode,
+                    uint32_t timeout = FP_RESPONSE_TIMEOUT);
+  FPM383FFrameDecoder::Status processIncoming();
+  
+  // Non-blocking request state
+  uint8_t requestState;
+  uint8_t requestCmd1;
+  uint8_t requestCmd2;
+  FPM383FDeadline requestDeadline;
+  
+  // Metrics
+  FingerprintMetrics metrics;
+  bool metricsPending;
+  uint8_t metricsCmd1;
+  uint8_t metricsCmd2;
+  uint32_t metricsStartTime;
+  void metricsBeginCall(uint8_t cmd1, uint8_t cmd2);
+  void metricsEndCall(bool transportOk, uint32_t errorCode);
+  
+  // Link health
+  bool failFast;
+  uint16_t consecutiveTimeouts;
+  uint32_t lastFrameTime;
+  
+  uint8_t verifyMode;
+  FPM383FScoreTracker* scoreTracker;
+  bool searchSync(FingerprintMatchResult* result);  // matchSync without recording
   
 public:
   FPM383F(int rxPin, int txPin, int touchPin = -1);
+  FPM383F(Stream& stream, int touchPin = -1);
   ~FPM383F();
   
   // Initialization
@@ -147,6 +140,13 @@ public:
   bool startMatch();
   FingerprintMatchResult queryMatchResult();
   FingerprintMatchResult matchSync();
+  FingerprintMatchResult verify(uint16_t fingerprintId);  // matched only if the finger is fingerprintId
+  void setVerifyMode(uint8_t mode);
+  uint8_t getVerifyMode();
+  
+  // Match-score analytics; results of matchSync, queryMatchResult and verify are recorded (nullptr detaches)
+  void setScoreTracker(FPM383FScoreTracker* tracker);
+  FPM383FScoreTracker* getScoreTracker();
   
   // Fingerprint management
   bool deleteFingerprint(uint16_t fingerprintId);
@@ -172,10 +172,34 @@ public:
   bool waitForFinger(uint32_t timeout = 10000);
   bool waitForFingerRemoval(uint32_t timeout = 5000);
   
+  // Non-blocking requests (do not mix with blocking calls while a request is pending)
+  bool beginRequest(uint8_t cmd1, uint8_t cmd2, uint8_t* data = nullptr, uint16_t dataLen = 0, uint32_t timeout = FP_RESPONSE_TIMEOUT);
+  uint8_t pollRequest();
+  bool isRequestPending();
+  uint32_t getResponseError();
+  const uint8_t* getResponseData();
+  uint16_t getResponseLength();
+  
   // Utility functions
   uint32_t getLastError();
   String getErrorString(uint32_t errorCode);
   void enableDebug(bool enable);
+  void setClock(FPM383FClock& clock);
+  FPM383FClock& getClock();
+  
+  // Link health (see FPM383FHealth)
+  void setFailFast(bool enable);   // commands fail with FP_ERROR_CIRCUIT_OPEN without touching the link
+  bool isFailFast();
+  uint16_t getConsecutiveTimeouts();
+  uint32_t getLastFrameTime();     // clock time of the last valid frame received
+  bool setLocalBaudrate(uint32_t baudrate);  // reopens the SoftwareSerial port only; false for external streams
+  
+  // Metrics
+  void getMetrics(FingerprintMetrics& snapshot);
+  void resetMetrics();
+  size_t getMetricsExportSize();
+  size_t exportMetrics(uint8_t* buffer, size_t bufferSize);
+  void printMetrics(Print& output);
   
 private:
   uint32_t lastError;
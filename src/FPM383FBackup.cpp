@@ -0,0 +1,344 @@
+#include "FPM383FBackup.h"
+
+static void putU16(uint8_t* p, uint16_t value) {
+  p[0] = (value >> 8) & 0xFF;
+  p[1] = value & 0xFF;
+}
+
+static void writeU16(Print& output, uint16_t value) {
+  output.write((uint8_t)((value >> 8) & 0xFF));
+  output.write((uint8_t)(value & 0xFF));
+}
+
+static bool readU16(Stream& input, uint16_t* value) {
+  uint8_t bytes[2];
+  if (input.readBytes(bytes, 2) != 2) return false;
+  *value = (bytes[0] << 8) | bytes[1];
+  return true;
+}
+
+FPM383FBackup::FPM383FBackup(FPM383F& driver, uint16_t chunkSize) : driver(driver) {
+  if (chunkSize == 0 || chunkSize > FP_BACKUP_CHUNK_SIZE) {
+    chunkSize = FP_BACKUP_CHUNK_SIZE;
+  }
+  this->chunkSize = chunkSize;
+  lastError = FP_ERROR_SUCCESS;
+  resetStats();
+}
+
+void FPM383FBackup::resetStats() {
+  memset(&stats, 0, sizeof(FPM383FBackupStats));
+}
+
+const FPM383FBackupStats& FPM383FBackup::getStats() {
+  return stats;
+}
+
+uint32_t FPM383FBackup::getThroughput() {
+  if (stats.elapsedMs == 0) return 0;
+  return (uint32_t)(((uint64_t)stats.bytes * 1000) / stats.elapsedMs);
+}
+
+uint32_t FPM383FBackup::getLastError() {
+  return lastError;
+}
+
+uint8_t FPM383FBackup::waitRequest() {
+  uint8_t state;
+  while ((state = driver.pollRequest()) == FP_REQUEST_PENDING) {
+    driver.getClock().sleep(0);
+  }
+
+  lastError = driver.getResponseError();
+  return state;
+}
+
+bool FPM383FBackup::transact(uint8_t cmd2, uint16_t dataLen) {
+  // Returns false only on transport failure; module errors are left in lastError
+  for (uint8_t attempt = 0; attempt <= FP_BACKUP_MAX_RETRIES; attempt++) {
+    if (attempt > 0) {
+      stats.retries++;
+    }
+    if (!driver.beginRequest(FP_CMD_FINGERPRINT_0, cmd2, frame, dataLen)) {
+      lastError = driver.getLastError();
+      return false;
+    }
+    if (waitRequest() == FP_REQUEST_DONE) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool FPM383FBackup::requestUploadChunk(uint16_t fingerprintId, uint16_t offset, uint16_t length) {
+  putU16(&frame[0], fingerprintId);
+  putU16(&frame[2], offset);
+  putU16(&frame[4], length);
+
+  if (!driver.beginRequest(FP_CMD_FINGERPRINT_0, FP_CMD_UPLOAD_TEMPLATE_DATA, frame, 6)) {
+    lastError = driver.getLastError();
+    return false;
+  }
+
+  return true;
+}
+
+bool FPM383FBackup::backup(Print& output, uint16_t firstId, uint16_t lastId) {
+  resetStats();
+  uint32_t startTime = driver.getClock().now();
+
+  output.write((const uint8_t*)"FPBK", 4);
+  output.write((uint8_t)FP_BACKUP_FORMAT_VERSION);
+  writeU16(output, chunkSize);
+
+  for (uint32_t id = firstId; id <= lastId; id++) {
+    putU16(&frame[0], id);
+
+    if (!transact(FP_CMD_UPLOAD_TEMPLATE_INFO, 2)) {
+      stats.elapsedMs = driver.getClock().now() - startTime;
+      return false;
+    }
+
+    // Empty slots are reported as a module error or a zero size
+    uint16_t size = 0;
+    if (lastError == FP_ERROR_SUCCESS && driver.getResponseLength() >= 2) {
+      const uint8_t* data = driver.getResponseData();
+      size = (data[0] << 8) | data[1];
+    }
+
+    if (size == 0) {
+      stats.skipped++;
+      continue;
+    }
+
+    if (!backupTemplate(output, id, size)) {
+      stats.elapsedMs = driver.getClock().now() - startTime;
+      return false;
+    }
+
+    stats.templates++;
+    stats.lastId = id;
+  }
+
+  output.write((uint8_t)FP_BACKUP_TAG_END);
+  writeU16(output, stats.templates);
+
+  stats.elapsedMs = driver.getClock().now() - startTime;
+  lastError = FP_ERROR_SUCCESS;
+  return true;
+}
+
+bool FPM383FBackup::backupTemplate(Print& output, uint16_t fingerprintId, uint16_t size) {
+  uint8_t* chunk = &frame[6];
+
+  output.write((uint8_t)FP_BACKUP_TAG_TEMPLATE);
+  writeU16(output, fingerprintId);
+  writeU16(output, size);
+
+  uint16_t offset = 0;
+  uint16_t length = min(chunkSize, size);
+
+  if (!requestUploadChunk(fingerprintId, offset, length)) {
+    return false;
+  }
+
+  while (offset < size) {
+    uint8_t retries = 0;
+
+    while (waitRequest() != FP_REQUEST_DONE || lastError != FP_ERROR_SUCCESS ||
+           driver.getResponseLength() != length) {
+      if (lastError == FP_ERROR_SUCCESS) {
+        lastError = FP_ERROR_INVALID_LENGTH;
+      }
+      if (retries++ >= FP_BACKUP_MAX_RETRIES) {
+        return false;
+      }
+      stats.retries++;
+      if (!requestUploadChunk(fingerprintId, offset, length)) {
+        return false;
+      }
+    }
+
+    memcpy(chunk, driver.getResponseData(), length);
+
+    // Request the next chunk before storing this one so the link stays busy
+    uint16_t nextOffset = offset + length;
+    uint16_t nextLength = min(chunkSize, (uint16_t)(size - nextOffset));
+    if (nextOffset < size && !requestUploadChunk(fingerprintId, nextOffset, nextLength)) {
+      return false;
+    }
+
+    output.write(chunk, length);
+    writeU16(output, crc16(chunk, length));
+
+    stats.bytes += length;
+    stats.chunks++;
+    offset = nextOffset;
+    length = nextLength;
+  }
+
+  return true;
+}
+
+bool FPM383FBackup::restore(Stream& input, uint16_t resumeFromId) {
+  resetStats();
+  uint32_t startTime = driver.getClock().now();
+
+  uint8_t header[7];
+  if (input.readBytes(header, 7) != 7) {
+    lastError = FP_ERROR_READ_FAILED;
+    return false;
+  }
+
+  uint16_t fileChunkSize = (header[5] << 8) | header[6];
+  if (memcmp(header, "FPBK", 4) != 0 || header[4] != FP_BACKUP_FORMAT_VERSION) {
+    lastError = FP_ERROR_INVALID_DATA;
+    return false;
+  }
+  if (fileChunkSize == 0 || fileChunkSize > FP_BACKUP_CHUNK_SIZE) {
+    lastError = FP_ERROR_INVALID_LENGTH;
+    return false;
+  }
+
+  uint16_t records = 0;
+
+  for (;;) {
+    uint8_t tag;
+    if (input.readBytes(&tag, 1) != 1) {
+      lastError = FP_ERROR_READ_FAILED;
+      break;
+    }
+
+    if (tag == FP_BACKUP_TAG_END) {
+      uint16_t count;
+      if (!readU16(input, &count)) {
+        lastError = FP_ERROR_READ_FAILED;
+      } else if (count != records) {
+        lastError = FP_ERROR_INVALID_DATA;
+      } else {
+        lastError = FP_ERROR_SUCCESS;
+      }
+      break;
+    }
+
+    uint16_t fingerprintId, size;
+    if (tag != FP_BACKUP_TAG_TEMPLATE || !readU16(input, &fingerprintId) || !readU16(input, &size)) {
+      lastError = FP_ERROR_INVALID_DATA;
+      break;
+    }
+
+    bool skip = fingerprintId < resumeFromId;
+    if (!restoreTemplate(input, fingerprintId, size, fileChunkSize, skip)) {
+      break;
+    }
+
+    records++;
+    if (skip) {
+      stats.skipped++;
+    } else {
+      stats.templates++;
+      stats.lastId = fingerprintId;
+    }
+  }
+
+  stats.elapsedMs = driver.getClock().now() - startTime;
+  return lastError == FP_ERROR_SUCCESS;
+}
+
+bool FPM383FBackup::restoreTemplate(Stream& input, uint16_t fingerprintId, uint16_t size, uint16_t fileChunkSize, bool skip) {
+  uint8_t* chunk = &frame[4];
+
+  if (!skip) {
+    putU16(&frame[0], fingerprintId);
+    putU16(&frame[2], size);
+    if (!transact(FP_CMD_DOWNLOAD_TEMPLATE_INFO, 4) || lastError != FP_ERROR_SUCCESS) {
+      return false;
+    }
+  }
+
+  uint16_t offset = 0;
+  uint16_t length = min(fileChunkSize, size);
+
+  if (offset < size && !readChunk(input, pending, length)) {
+    return false;
+  }
+
+  while (offset < size) {
+    uint16_t nextOffset = offset + length;
+    uint16_t nextLength = min(fileChunkSize, (uint16_t)(size - nextOffset));
+
+    if (skip) {
+      if (nextOffset < size && !readChunk(input, pending, nextLength)) {
+        return false;
+      }
+      offset = nextOffset;
+      length = nextLength;
+      continue;
+    }
+
+    putU16(&frame[0], fingerprintId);
+    putU16(&frame[2], offset);
+    memcpy(chunk, pending, length);
+
+    if (!driver.beginRequest(FP_CMD_FINGERPRINT_0, FP_CMD_DOWNLOAD_TEMPLATE_DATA, frame, 4 + length)) {
+      lastError = driver.getLastError();
+      return false;
+    }
+
+    // Read the next chunk from storage while the module stores this one
+    if (nextOffset < size && !readChunk(input, pending, nextLength)) {
+      uint32_t readError = lastError;
+      waitRequest();
+      lastError = readError;
+      return false;
+    }
+
+    uint8_t retries = 0;
+    while (waitRequest() != FP_REQUEST_DONE || lastError != FP_ERROR_SUCCESS) {
+      if (retries++ >= FP_BACKUP_MAX_RETRIES) {
+        return false;
+      }
+      stats.retries++;
+      if (!driver.beginRequest(FP_CMD_FINGERPRINT_0, FP_CMD_DOWNLOAD_TEMPLATE_DATA, frame, 4 + length)) {
+        lastError = driver.getLastError();
+        return false;
+      }
+    }
+
+    stats.bytes += length;
+    stats.chunks++;
+    offset = nextOffset;
+    length = nextLength;
+  }
+
+  return true;
+}
+
+bool FPM383FBackup::readChunk(Stream& input, uint8_t* data, uint16_t length) {
+  uint16_t crc;
+
+  if (input.readBytes(data, length) != length || !readU16(input, &crc)) {
+    lastError = FP_ERROR_READ_FAILED;
+    return false;
+  }
+
+  if (crc != crc16(data, length)) {
+    lastError = FP_ERROR_INVALID_DATA;
+    return false;
+  }
+
+  return true;
+}
+
+uint16_t FPM383FBackup::crc16(const uint8_t* data, uint16_t length) {
+  // CRC-16/CCITT-FALSE
+  uint16_t crc = 0xFFFF;
+  for (uint16_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+  }
+  return crc;
+}
@@ -0,0 +1,102 @@
+#ifndef FPM383F_BACKUP_H
+#define FPM383F_BACKUP_H
+
+// Streaming template backup and restore. Templates are transferred in chunks
+// over the non-blocking request API so the next chunk is already on the wire
+// while the current one is written to (or read from) storage.
+//
+// Container format (all values big-endian):
+//   header:   'F' 'P' 'B' 'K', version (1), chunk size (2)
+//   template: 'T', id (2), size (2), then ceil(size / chunk size) chunks of
+//             chunk data followed by its CRC-16/CCITT (2); the last chunk holds
+//             the remainder
+//   trailer:  'E', template count (2)
+//
+// A backup that fails part-way reports the last completed template in
+// getStats().lastId; start a new container from the next id to resume, and
+// pass resumeFromId to restore() to skip templates already written back.
+//
+// With pipelining the module's response arrives while the previous chunk is
+// being stored, so the serial RX buffer must hold one full frame (chunk size
+// + 22 bytes). FP_BACKUP_RX_BUFFER is the buffer the chunk size is derived
+// from; its default fits the smallest buffer among the supported transports
+// (AVR SoftwareSerial and EspSoftwareSerial, 64 bytes). For larger chunks,
+// raise the port's buffer before begin() and define FP_BACKUP_RX_BUFFER to
+// match, e.g. Serial2.setRxBufferSize(1024) with -DFP_BACKUP_RX_BUFFER=1024 on
+// ESP32 (HardwareSerial defaults to 256 bytes).
+
+#include "FPM383F.h"
+
+#define FP_BACKUP_FORMAT_VERSION 0x01
+#define FP_BACKUP_TAG_TEMPLATE 'T'
+#define FP_BACKUP_TAG_END 'E'
+#define FP_BACKUP_MAX_RETRIES 3
+
+#ifndef FP_BACKUP_RX_BUFFER
+#define FP_BACKUP_RX_BUFFER 64
+#endif
+
+// A ring buffer of n bytes holds n - 1; the response carries the chunk after
+// FP_RESPONSE_MIN_LENGTH bytes of status
+#define FP_BACKUP_FRAME_SIZE(chunk) ((chunk) + FP_FRAME_OVERHEAD + FP_RESPONSE_MIN_LENGTH)
+
+#ifndef FP_BACKUP_CHUNK_SIZE
+#if FP_BACKUP_RX_BUFFER - 1 - FP_BACKUP_FRAME_SIZE(0) < FP_MAX_FRAME_DATA - FP_RESPONSE_MIN_LENGTH
+#define FP_BACKUP_CHUNK_SIZE (FP_BACKUP_RX_BUFFER - 1 - FP_BACKUP_FRAME_SIZE(0))
+#else
+#define FP_BACKUP_CHUNK_SIZE (FP_MAX_FRAME_DATA - FP_RESPONSE_MIN_LENGTH)
+#endif
+#endif
+
+#if FP_BACKUP_CHUNK_SIZE > FP_MAX_FRAME_DATA - FP_RESPONSE_MIN_LENGTH
+#error "FP_BACKUP_CHUNK_SIZE does not fit in a response frame"
+#endif
+
+#if FP_BACKUP_FRAME_SIZE(FP_BACKUP_CHUNK_SIZE) > FP_BACKUP_RX_BUFFER - 1
+#error "FP_BACKUP_CHUNK_SIZE response frames overflow the RX buffer; raise it and define FP_BACKUP_RX_BUFFER"
+#endif
+
+#if defined(_SS_MAX_RX_BUFF) && FP_BACKUP_RX_BUFFER > _SS_MAX_RX_BUFF
+#error "FP_BACKUP_RX_BUFFER is larger than the SoftwareSerial RX buffer (_SS_MAX_RX_BUFF)"
+#endif
+
+struct FPM383FBackupStats {
+  uint16_t templates;      // templates transferred completely
+  uint16_t skipped;        // empty ids (backup) or ids before resumeFromId (restore)
+  uint16_t lastId;         // last template transferred completely
+  uint32_t bytes;          // template bytes moved over the link
+  uint32_t chunks;
+  uint32_t retries;
+  uint32_t elapsedMs;
+};
+
+class FPM383FBackup {
+public:
+  FPM383FBackup(FPM383F& driver, uint16_t chunkSize = FP_BACKUP_CHUNK_SIZE);
+
+  bool backup(Print& output, uint16_t firstId, uint16_t lastId);
+  bool restore(Stream& input, uint16_t resumeFromId = 0);
+
+  const FPM383FBackupStats& getStats();
+  uint32_t getThroughput();  // template bytes per second of the last backup/restore
+  uint32_t getLastError();
+
+private:
+  FPM383F& driver;
+  uint16_t chunkSize;
+  uint32_t lastError;
+  FPM383FBackupStats stats;
+  uint8_t frame[6 + FP_BACKUP_CHUNK_SIZE];  // id + offset (+ length) header, then chunk data
+  uint8_t pending[FP_BACKUP_CHUNK_SIZE];    // next chunk read from storage during restore
+
+  void resetStats();
+  bool transact(uint8_t cmd2, uint16_t dataLen);
+  uint8_t waitRequest();
+  bool backupTemplate(Print& output, uint16_t fingerprintId, uint16_t size);
+  bool restoreTemplate(Stream& input, uint16_t fingerprintId, uint16_t size, uint16_t fileChunkSize, bool skip);
+  bool requestUploadChunk(uint16_t fingerprintId, uint16_t offset, uint16_t length);
+  bool readChunk(Stream& input, uint8_t* data, uint16_t length);
+  static uint16_t crc16(const uint8_t* data, uint16_t length);
+};
+
+#endif
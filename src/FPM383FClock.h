@@ -0,0 +1,63 @@
+#ifndef FPM383F_CLOCK_H
+#define FPM383F_CLOCK_H
+
+// Time source used for every wait in the driver. The default clock wraps
+// millis()/delay(); host harnesses can install FPM383FManualClock (or their
+// own) to run scenarios in virtual time. Must not depend on Arduino headers.
+
+#include <stdint.h>
+
+class FPM383FClock {
+public:
+  virtual ~FPM383FClock() {}
+
+  // Milliseconds since an arbitrary epoch; allowed to wrap around
+  virtual uint32_t now() = 0;
+
+  // Called while waiting for the module; sleep(0) means "yield" and is used
+  // by polling loops
+  virtual void sleep(uint32_t ms) = 0;
+};
+
+// Virtual clock: time only moves when the driver sleeps or advance() is called.
+// Every sleep advances at least 1ms so polling loops make progress.
+class FPM383FManualClock : public FPM383FClock {
+public:
+  explicit FPM383FManualClock(uint32_t start = 0) : current(start) {}
+
+  uint32_t now() { return current; }
+  void sleep(uint32_t ms) { current += ms ? ms : 1; }
+  void advance(uint32_t ms) { current += ms; }
+  void set(uint32_t ms) { current = ms; }
+
+private:
+  uint32_t current;
+};
+
+// Deadline that stays correct across the 32-bit millisecond wraparound:
+// elapsed time is computed with unsigned subtraction, never by comparing
+// absolute timestamps.
+class FPM383FDeadline {
+public:
+  FPM383FDeadline() : start(0), duration(0) {}
+  FPM383FDeadline(uint32_t now, uint32_t duration) : start(now), duration(duration) {}
+
+  bool expired(uint32_t now) const {
+    return now - start >= duration;
+  }
+
+  uint32_t elapsed(uint32_t now) const {
+    return now - start;
+  }
+
+  uint32_t remaining(uint32_t now) const {
+    uint32_t passed = now - start;
+    return passed >= duration ? 0 : duration - passed;
+  }
+
+private:
+  uint32_t start;
+  uint32_t duration;
+};
+
+#endif
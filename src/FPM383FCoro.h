@@ -0,0 +1,278 @@
+#ifndef FPM383F_CORO_H
+#define FPM383F_CORO_H
+
+// Optional C++20 coroutine layer on top of the non-blocking request API.
+// Awaiting an operation sends its command frame and suspends the coroutine;
+// poll() resumes it from loop() once the response frame has been decoded.
+//
+//   FPM383F fingerprint(2, 4, 3);
+//   FPM383FCoro fp(fingerprint);
+//
+//   FPM383FTask identify() {
+//     FingerprintMatchResult result = co_await fp.match();
+//     co_await fp.setLED(FP_LED_MODE_ON, result.matched ? FP_LED_GREEN : FP_LED_RED);
+//   }
+//
+//   void loop() {
+//     fp.poll();
+//   }
+//
+// Only one coroutine can wait on the link at a time; an operation awaited
+// while another is in flight completes immediately with a failed result.
+// Keep the FPM383FTask alive until done() returns true.
+
+#include "FPM383F.h"
+
+// Preprocessors without __has_include fail on it even in a short-circuited
+// condition, so it is only evaluated once it is known to exist
+#if __cplusplus < 202002L
+#error "FPM383FCoro.h requires a C++20 compiler with <coroutine>"
+#endif
+#if defined(__has_include)
+#if !__has_include(<coroutine>)
+#error "FPM383FCoro.h requires a C++20 compiler with <coroutine>"
+#endif
+#endif
+
+#include <coroutine>
+#include <exception>
+
+// Longest command data an awaitable request carries (SET_LED)
+#define FP_CORO_MAX_DATA 5
+
+class FPM383FTask {
+public:
+  struct promise_type {
+    FPM383FTask get_return_object() {
+      return FPM383FTask(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  explicit FPM383FTask(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+  FPM383FTask(FPM383FTask&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+  FPM383FTask(const FPM383FTask&) = delete;
+  FPM383FTask& operator=(const FPM383FTask&) = delete;
+
+  FPM383FTask& operator=(FPM383FTask&& other) noexcept {
+    if (this != &other) {
+      if (handle) handle.destroy();
+      handle = other.handle;
+      other.handle = nullptr;
+    }
+    return *this;
+  }
+
+  ~FPM383FTask() {
+    if (handle) handle.destroy();
+  }
+
+  bool done() const {
+    return !handle || handle.done();
+  }
+
+private:
+  std::coroutine_handle<promise_type> handle;
+};
+
+class FPM383FCoro;
+
+template <typename T>
+class FPM383FRequest {
+public:
+  typedef T (*Parser)(FPM383F& driver, bool completed);
+
+  FPM383FRequest(FPM383FCoro& owner, uint8_t cmd1, uint8_t cmd2, const uint8_t* data, uint8_t dataLen,
+                 uint32_t timeout, Parser parser)
+    : owner(owner), cmd1(cmd1), cmd2(cmd2), dataLen(dataLen), timeout(timeout), parser(parser), started(false) {
+    // Longer data is never truncated; await_suspend() fails the request instead
+    for (uint8_t i = 0; i < dataLen && dataLen <= FP_CORO_MAX_DATA; i++) {
+      this->data[i] = data[i];
+    }
+  }
+
+  bool await_ready() const noexcept { return false; }
+  bool await_suspend(std::coroutine_handle<> handle);
+  T await_resume();
+
+private:
+  FPM383FCoro& owner;
+  uint8_t cmd1;
+  uint8_t cmd2;
+  uint8_t data[FP_CORO_MAX_DATA];
+  uint8_t dataLen;
+  uint32_t timeout;
+  Parser parser;
+  bool started;
+};
+
+class FPM383FDelay {
+public:
+  FPM383FDelay(FPM383FCoro& owner, uint32_t duration) : owner(owner), duration(duration) {}
+
+  bool await_ready() const noexcept { return duration == 0; }
+  bool await_suspend(std::coroutine_handle<> handle);
+  void await_resume() {}
+
+private:
+  FPM383FCoro& owner;
+  uint32_t duration;
+};
+
+class FPM383FCoro {
+public:
+  explicit FPM383FCoro(FPM383F& driver) : driver(driver), waiter(nullptr), delayActive(false) {}
+
+  // Resumes the waiting coroutine once its response (or delay) has completed.
+  // Call from loop().
+  void poll() {
+    if (!waiter) return;
+
+    if (delayActive) {
+      if (!delayDeadline.expired(driver.getClock().now())) return;
+      delayActive = false;
+    } else if (driver.pollRequest() == FP_REQUEST_PENDING) {
+      return;
+    }
+
+    std::coroutine_handle<> handle = waiter;
+    waiter = nullptr;
+    handle.resume();
+  }
+
+  bool isBusy() const {
+    return waiter != nullptr;
+  }
+
+  FPM383F& getDriver() {
+    return driver;
+  }
+
+  // Awaitable operations
+  FPM383FRequest<bool> heartbeat() {
+    return FPM383FRequest<bool>(*this, FP_CMD_MAINTENANCE_0, FP_CMD_HEARTBEAT, nullptr, 0, FP_RESPONSE_TIMEOUT, parseStatus);
+  }
+
+  FPM383FRequest<FingerprintMatchResult> match(uint32_t timeout = FP_RESPONSE_TIMEOUT) {
+    return FPM383FRequest<FingerprintMatchResult>(*this, FP_CMD_FINGERPRINT_0, FP_CMD_MATCH_SYNC, nullptr, 0,
+                                                  timeout, parseMatch);
+  }
+
+  FPM383FRequest<bool> startMatch() {
+    return FPM383FRequest<bool>(*this, FP_CMD_FINGERPRINT_0, FP_CMD_MATCH, nullptr, 0, FP_RESPONSE_TIMEOUT, parseStatus);
+  }
+
+  FPM383FRequest<FingerprintMatchResult> queryMatchResult() {
+    return FPM383FRequest<FingerprintMatchResult>(*this, FP_CMD_FINGERPRINT_0, FP_CMD_QUERY_MATCH, nullptr, 0,
+                                                  FP_RESPONSE_TIMEOUT, parseMatch);
+  }
+
+  FPM383FRequest<bool> startEnrollment(uint8_t regIndex) {
+    uint8_t data[1] = {regIndex};
+    return FPM383FRequest<bool>(*this, FP_CMD_FINGERPRINT_0, FP_CMD_ENROLL, data, 1, FP_RESPONSE_TIMEOUT, parseStatus);
+  }
+
+  FPM383FRequest<FingerprintEnrollResult> queryEnrollmentResult() {
+    return FPM383FRequest<FingerprintEnrollResult>(*this, FP_CMD_FINGERPRINT_0, FP_CMD_QUERY_ENROLL, nullptr, 0,
+                                                   FP_RESPONSE_TIMEOUT, parseEnroll);
+  }
+
+  FPM383FRequest<bool> saveTemplate(uint16_t fingerprintId) {
+    uint8_t data[2] = {(uint8_t)(fingerprintId >> 8), (uint8_t)(fingerprintId & 0xFF)};
+    return FPM383FRequest<bool>(*this, FP_CMD_FINGERPRINT_0, FP_CMD_SAVE_TEMPLATE, data, 2, FP_RESPONSE_TIMEOUT, parseStatus);
+  }
+
+  FPM383FRequest<bool> querySaveResult() {
+    return FPM383FRequest<bool>(*this, FP_CMD_FINGERPRINT_0, FP_CMD_QUERY_SAVE, nullptr, 0, FP_RESPONSE_TIMEOUT, parseStatus);
+  }
+
+  FPM383FRequest<bool> deleteFingerprint(uint16_t fingerprintId) {
+    uint8_t data[3] = {0x00, (uint8_t)(fingerprintId >> 8), (uint8_t)(fingerprintId & 0xFF)};
+    return FPM383FRequest<bool>(*this, FP_CMD_FINGERPRINT_0, FP_CMD_DELETE, data, 3, FP_RESPONSE_TIMEOUT, parseStatus);
+  }
+
+  FPM383FRequest<uint16_t> getTemplateCount() {
+    return FPM383FRequest<uint16_t>(*this, FP_CMD_SYSTEM_0, FP_CMD_GET_TEMPLATE_COUNT, nullptr, 0, FP_RESPONSE_TIMEOUT,
+                                    parseTemplateCount);
+  }
+
+  FPM383FRequest<bool> setLED(uint8_t mode, uint8_t color, uint8_t param1 = 0, uint8_t param2 = 0, uint8_t param3 = 0) {
+    uint8_t data[5] = {mode, color, param1, param2, param3};
+    return FPM383FRequest<bool>(*this, FP_CMD_SYSTEM_0, FP_CMD_SET_LED, data, 5, FP_RESPONSE_TIMEOUT, parseStatus);
+  }
+
+  FPM383FDelay delay(uint32_t duration) {
+    return FPM383FDelay(*this, duration);
+  }
+
+private:
+  template <typename T> friend class FPM383FRequest;
+  friend class FPM383FDelay;
+
+  FPM383F& driver;
+  std::coroutine_handle<> waiter;
+  bool delayActive;
+  FPM383FDeadline delayDeadline;
+
+  static bool parseStatus(FPM383F& driver, bool completed) {
+    return completed && driver.getResponseError() == FP_ERROR_SUCCESS;
+  }
+
+  static FingerprintMatchResult parseMatch(FPM383F& driver, bool completed) {
+    FingerprintMatchResult result = {false, 0, 0};
+    if (completed && driver.getResponseError() == FP_ERROR_SUCCESS) {
+      fpm383fParseMatchResult(driver.getResponseData(), driver.getResponseLength(), &result);
+    }
+    return result;
+  }
+
+  static FingerprintEnrollResult parseEnroll(FPM383F& driver, bool completed) {
+    FingerprintEnrollResult result = {0, 0, false};
+    if (completed && driver.getResponseError() == FP_ERROR_SUCCESS) {
+      fpm383fParseEnrollResult(driver.getResponseData(), driver.getResponseLength(), &result);
+    }
+    return result;
+  }
+
+  static uint16_t parseTemplateCount(FPM383F& driver, bool completed) {
+    uint16_t count = 0;
+    if (completed && driver.getResponseError() == FP_ERROR_SUCCESS) {
+      fpm383fParseTemplateCount(driver.getResponseData(), driver.getResponseLength(), &count);
+    }
+    return count;
+  }
+};
+
+template <typename T>
+bool FPM383FRequest<T>::await_suspend(std::coroutine_handle<> handle) {
+  if (dataLen > FP_CORO_MAX_DATA || owner.waiter ||
+      !owner.driver.beginRequest(cmd1, cmd2, dataLen ? data : nullptr, dataLen, timeout)) {
+    // Data too long or link busy: resume immediately and report failure
+    return false;
+  }
+
+  started = true;
+  owner.waiter = handle;
+  return true;
+}
+
+template <typename T>
+T FPM383FRequest<T>::await_resume() {
+  return parser(owner.driver, started && owner.driver.pollRequest() == FP_REQUEST_DONE);
+}
+
+inline bool FPM383FDelay::await_suspend(std::coroutine_handle<> handle) {
+  if (owner.waiter) {
+    return false;
+  }
+
+  owner.delayActive = true;
+  owner.delayDeadline = FPM383FDeadline(owner.driver.getClock().now(), duration);
+  owner.waiter = handle;
+  return true;
+}
+
+#endif
@@ -0,0 +1,335 @@
+#include "FPM383FHealth.h"
+
+// Baudrates tried by re-sync after the configured one
+static const uint32_t resyncBaudrates[] = {57600, 115200, 9600, 19200, 38400};
+#define FP_HEALTH_RESYNC_COUNT (sizeof(resyncBaudrates) / sizeof(resyncBaudrates[0]))
+
+FPM383FHealth::FPM383FHealth(FPM383F& driver, uint32_t baudrate) : driver(driver) {
+  this->baudrate = baudrate;
+  heartbeatInterval = FP_HEALTH_HEARTBEAT_INTERVAL;
+  probeTimeout = FP_HEALTH_PROBE_TIMEOUT;
+  tripThreshold = FP_HEALTH_TRIP_THRESHOLD;
+  baudrateCallback = nullptr;
+  state = FP_HEALTH_UP;
+  step = STEP_PROBE;
+  pending = PENDING_NONE;
+  resyncIndex = 0;
+  probeDue = false;
+  backoff = FP_HEALTH_RETRY_MIN;
+  downSince = 0;
+  lastProbeTime = 0;
+  lastUpdate = 0;
+  started = false;
+  resetStats();
+}
+
+void FPM383FHealth::setHeartbeatInterval(uint32_t ms) {
+  heartbeatInterval = ms;
+}
+
+void FPM383FHealth::setProbeTimeout(uint32_t ms) {
+  probeTimeout = ms;
+}
+
+void FPM383FHealth::setTripThreshold(uint16_t timeouts) {
+  tripThreshold = timeouts ? timeouts : 1;
+}
+
+void FPM383FHealth::setBaudrateCallback(void (*callback)(uint32_t baudrate)) {
+  baudrateCallback = callback;
+}
+
+void FPM383FHealth::update() {
+  uint32_t now = driver.getClock().now();
+  account(now);
+
+  if (pending != PENDING_NONE) {
+    uint8_t status = driver.pollRequest();
+    if (status != FP_REQUEST_PENDING) {
+      complete(now, status == FP_REQUEST_DONE);
+    }
+    return;
+  }
+
+  // The application's request owns the link until it completes
+  if (driver.isRequestPending()) {
+    return;
+  }
+
+  if (state == FP_HEALTH_UP) {
+    if (driver.getConsecutiveTimeouts() >= tripThreshold) {
+      trip(now);
+      return;
+    }
+    if (now - driver.getLastFrameTime() >= heartbeatInterval && now - lastProbeTime >= heartbeatInterval) {
+      heartbeat(now);
+    }
+    return;
+  }
+
+  if (stepDeadline.expired(now)) {
+    recover(now);
+  }
+}
+
+uint8_t FPM383FHealth::getState() {
+  return state;
+}
+
+bool FPM383FHealth::isAvailable() {
+  return state == FP_HEALTH_UP;
+}
+
+const FPM383FHealthStats& FPM383FHealth::getStats() {
+  return stats;
+}
+
+uint16_t FPM383FHealth::getAvailability() {
+  uint64_t total = (uint64_t)stats.upMs + stats.downMs;
+  if (total == 0) return 10000;
+  return (uint16_t)(((uint64_t)stats.upMs * 10000) / total);
+}
+
+void FPM383FHealth::resetStats() {
+  memset(&stats, 0, sizeof(FPM383FHealthStats));
+}
+
+void FPM383FHealth::printStats(Print& output) {
+  uint16_t availability = getAvailability();
+  output.println("FPM383F health:");
+  output.print("  state=");
+  output.println(state == FP_HEALTH_UP ? "up" : (state == FP_HEALTH_DOWN ? "down" : "recovering"));
+  output.print("  availability=");
+  output.print(availability / 100);
+  output.print('.');
+  if (availability % 100 < 10) output.print('0');
+  output.print(availability % 100);
+  output.println('%');
+  output.println("  heartbeats=" + String(stats.heartbeats) + " failed=" + String(stats.heartbeatFailures) +
+                 " trips=" + String(stats.trips));
+  output.println("  recoveries=" + String(stats.recoveries) + "/" + String(stats.recoveryAttempts) +
+                 " last=" + String(stats.lastRecoveryMs) + "ms max=" + String(stats.maxRecoveryMs) + "ms" +
+                 " avg=" + String(stats.recoveries ? stats.totalRecoveryMs / stats.recoveries : 0) + "ms");
+}
+
+void FPM383FHealth::account(uint32_t now) {
+  if (!started) {
+    started = true;
+    lastUpdate = now;
+    return;
+  }
+
+  uint32_t delta = now - lastUpdate;
+  lastUpdate = now;
+  if (state == FP_HEALTH_UP) {
+    stats.upMs += delta;
+  } else {
+    stats.downMs += delta;
+  }
+}
+
+void FPM383FHealth::heartbeat(uint32_t now) {
+  stats.heartbeats++;
+  lastProbeTime = now;
+  if (!start(PENDING_HEARTBEAT, FP_CMD_MAINTENANCE_0, FP_CMD_HEARTBEAT)) {
+    stats.heartbeatFailures++;
+  }
+}
+
+void FPM383FHealth::trip(uint32_t now) {
+  stats.trips++;
+  state = FP_HEALTH_DOWN;
+  downSince = now;
+  backoff = FP_HEALTH_RETRY_MIN;
+  step = STEP_PROBE;
+  probeDue = false;
+  stepDeadline = FPM383FDeadline(now, backoff);
+  driver.setFailFast(true);
+}
+
+// Starts one recovery step: either the step's action, or the heartbeat probe
+// that follows it once the module has had time to settle
+void FPM383FHealth::recover(uint32_t now) {
+  state = FP_HEALTH_RECOVERING;
+
+  if (probeDue) {
+    probeDue = false;
+    if (!start(PENDING_PROBE, FP_CMD_MAINTENANCE_0, FP_CMD_HEARTBEAT)) {
+      nextStep(now);
+    }
+    return;
+  }
+
+  switch (step) {
+    case STEP_PROBE:
+      stats.recoveryAttempts++;
+      settle(now, 0);
+      break;
+    case STEP_RESET:
+      // Probed after the settle time whether or not the reset was answered
+      if (!start(PENDING_RESET, FP_CMD_SYSTEM_0, FP_CMD_RESET_MODULE)) {
+        settle(now, FP_HEALTH_SETTLE_TIME);
+      }
+      break;
+    case STEP_REBEGIN:
+      if (!reopen(baudrate)) {
+        nextStep(now);
+        return;
+      }
+      settle(now, FP_HEALTH_SETTLE_TIME);
+      break;
+    case STEP_RESYNC:
+      if (!reopen(resyncBaudrates[resyncIndex])) {
+        nextStep(now);
+        return;
+      }
+      settle(now, FP_HEALTH_SETTLE_TIME);
+      break;
+  }
+}
+
+// Handles the response (or failure) of our request in flight
+void FPM383FHealth::complete(uint32_t now, bool answered) {
+  Pending kind = pending;
+  pending = PENDING_NONE;
+
+  switch (kind) {
+    case PENDING_HEARTBEAT:
+      if (!answered) {
+        stats.heartbeatFailures++;
+      }
+      if (driver.getConsecutiveTimeouts() >= tripThreshold) {
+        trip(now);
+      }
+      break;
+    case PENDING_PROBE:
+      probed(now, answered);
+      break;
+    case PENDING_RESET:
+      settle(now, FP_HEALTH_SETTLE_TIME);
+      break;
+    case PENDING_SWITCH:
+      if (!answered || driver.getResponseError() != FP_ERROR_SUCCESS) {
+        nextStep(now);
+        break;
+      }
+      // The module answers at the old rate and then switches; follow it and
+      // probe once more at the configured rate
+      reopen(baudrate);
+      step = STEP_REBEGIN;
+      settle(now, FP_HEALTH_SETTLE_TIME);
+      break;
+    case PENDING_NONE:
+      break;
+  }
+}
+
+void FPM383FHealth::probed(uint32_t now, bool answered) {
+  if (!answered) {
+    nextStep(now);
+    return;
+  }
+
+  // Found on another baudrate: switch the module back to the configured one
+  if (step == STEP_RESYNC) {
+    uint8_t data[4];
+    data[0] = (baudrate >> 24) & 0xFF;
+    data[1] = (baudrate >> 16) & 0xFF;
+    data[2] = (baudrate >> 8) & 0xFF;
+    data[3] = baudrate & 0xFF;
+    if (!start(PENDING_SWITCH, FP_CMD_MAINTENANCE_0, FP_CMD_SET_BAUDRATE, data, 4)) {
+      nextStep(now);
+    }
+    return;
+  }
+
+  recovered(now);
+}
+
+// Probes from the update() after ms
+void FPM383FHealth::settle(uint32_t now, uint32_t ms) {
+  probeDue = true;
+  stepDeadline = FPM383FDeadline(now, ms);
+}
+
+void FPM383FHealth::nextStep(uint32_t now) {
+  switch (step) {
+    case STEP_PROBE:
+      step = STEP_RESET;
+      break;
+    case STEP_RESET:
+      step = STEP_REBEGIN;
+      break;
+    case STEP_REBEGIN:
+      if (nextResyncIndex(0)) {
+        step = STEP_RESYNC;
+      } else {
+        step = STEP_PROBE;
+      }
+      break;
+    case STEP_RESYNC:
+      if (!nextResyncIndex(resyncIndex + 1)) {
+        step = STEP_PROBE;
+      }
+      break;
+  }
+
+  if (step != STEP_PROBE) {
+    stepDeadline = FPM383FDeadline(now, 0);
+    return;
+  }
+
+  // Attempt failed: return to the configured baudrate and back off
+  reopen(baudrate);
+  state = FP_HEALTH_DOWN;
+  stepDeadline = FPM383FDeadline(now, backoff);
+  backoff = backoff * 2 > FP_HEALTH_RETRY_MAX ? FP_HEALTH_RETRY_MAX : backoff * 2;
+}
+
+void FPM383FHealth::recovered(uint32_t now) {
+  uint32_t elapsed = now - downSince;
+
+  stats.recoveries++;
+  stats.lastRecoveryMs = elapsed;
+  stats.totalRecoveryMs += elapsed;
+  if (elapsed > stats.maxRecoveryMs) {
+    stats.maxRecoveryMs = elapsed;
+  }
+
+  state = FP_HEALTH_UP;
+  step = STEP_PROBE;
+  lastProbeTime = now;
+  driver.setFailFast(false);
+}
+
+// Sends one of our requests with the probe timeout; fail-fast is lifted for
+// the send only, since the breaker is what keeps the application's commands out
+bool FPM383FHealth::start(Pending kind, uint8_t cmd1, uint8_t cmd2, uint8_t* data, uint16_t dataLen) {
+  bool failFast = driver.isFailFast();
+
+  driver.setFailFast(false);
+  bool started = driver.beginRequest(cmd1, cmd2, data, dataLen, probeTimeout);
+  driver.setFailFast(failFast);
+  if (started) {
+    pending = kind;
+  }
+  return started;
+}
+
+bool FPM383FHealth::reopen(uint32_t rate) {
+  if (baudrateCallback) {
+    baudrateCallback(rate);
+    return true;
+  }
+  return driver.setLocalBaudrate(rate);
+}
+
+bool FPM383FHealth::nextResyncIndex(uint8_t from) {
+  for (uint8_t i = from; i < FP_HEALTH_RESYNC_COUNT; i++) {
+    if (resyncBaudrates[i] != baudrate) {
+      resyncIndex = i;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,127 @@
+#ifndef FPM383F_HEALTH_H
+#define FPM383F_HEALTH_H
+
+// Link health supervisor with a circuit breaker. Call update() from loop():
+//
+//   - while the link is idle (no frame for the heartbeat interval and no
+//     non-blocking request pending) a heartbeat is sent with a short timeout
+//   - after tripThreshold consecutive timeouts, from application calls or
+//     heartbeats, the breaker opens: the driver is put in fail-fast mode so
+//     every command fails at once with FP_ERROR_CIRCUIT_OPEN instead of
+//     waiting FP_RESPONSE_TIMEOUT
+//   - while open, recovery runs one step per update(): heartbeat probe,
+//     module reset, reopening the local port at the configured baudrate,
+//     then probing the other common baudrates (and switching the module back
+//     if it answers on one). Attempts back off exponentially.
+//
+// update() never waits for the module: heartbeats, probes, the reset and the
+// baudrate switch are sent with beginRequest() and completed by later
+// update() calls, and settle times are deadlines. Requests use the
+// non-blocking request slot, so read the result of a completed non-blocking
+// request before calling update(). Baudrate steps need the driver's
+// SoftwareSerial port, or a callback that reconfigures an external stream.
+
+#include "FPM383F.h"
+
+// Supervisor states
+#define FP_HEALTH_UP 0          // breaker closed
+#define FP_HEALTH_DOWN 1        // breaker open, waiting for the next recovery attempt
+#define FP_HEALTH_RECOVERING 2  // breaker open, recovery attempt in progress
+
+#ifndef FP_HEALTH_HEARTBEAT_INTERVAL
+#define FP_HEALTH_HEARTBEAT_INTERVAL 2000
+#endif
+#ifndef FP_HEALTH_PROBE_TIMEOUT
+#define FP_HEALTH_PROBE_TIMEOUT 300
+#endif
+#ifndef FP_HEALTH_TRIP_THRESHOLD
+#define FP_HEALTH_TRIP_THRESHOLD 2
+#endif
+#define FP_HEALTH_RETRY_MIN 500       // first backoff after a trip or failed attempt (ms)
+#define FP_HEALTH_RETRY_MAX 30000
+#define FP_HEALTH_SETTLE_TIME 200     // wait after a reset or port change before probing
+
+struct FPM383FHealthStats {
+  uint32_t heartbeats;           // idle heartbeats sent
+  uint32_t heartbeatFailures;
+  uint32_t trips;                // times the breaker opened
+  uint32_t recoveryAttempts;
+  uint32_t recoveries;
+  uint32_t lastRecoveryMs;       // time from trip to recovery
+  uint32_t maxRecoveryMs;
+  uint32_t totalRecoveryMs;
+  uint32_t upMs;                 // time spent with the breaker closed
+  uint32_t downMs;
+};
+
+class FPM383FHealth {
+public:
+  FPM383FHealth(FPM383F& driver, uint32_t baudrate = 57600);
+
+  void setHeartbeatInterval(uint32_t ms);
+  void setProbeTimeout(uint32_t ms);
+  void setTripThreshold(uint16_t timeouts);
+  // Reconfigures an external stream (e.g. HardwareSerial::updateBaudRate)
+  void setBaudrateCallback(void (*callback)(uint32_t baudrate));
+
+  void update();
+
+  uint8_t getState();
+  bool isAvailable();
+  const FPM383FHealthStats& getStats();
+  uint16_t getAvailability();    // share of time up, in 0.01% units
+  void resetStats();
+  void printStats(Print& output);
+
+private:
+  enum Step {
+    STEP_PROBE,
+    STEP_RESET,
+    STEP_REBEGIN,
+    STEP_RESYNC
+  };
+
+  // Request of ours in flight, completed by a later update()
+  enum Pending {
+    PENDING_NONE,
+    PENDING_HEARTBEAT,
+    PENDING_PROBE,
+    PENDING_RESET,
+    PENDING_SWITCH    // SET_BAUDRATE back to the configured rate after resync
+  };
+
+  FPM383F& driver;
+  uint32_t baudrate;
+  uint32_t heartbeatInterval;
+  uint32_t probeTimeout;
+  uint16_t tripThreshold;
+  void (*baudrateCallback)(uint32_t baudrate);
+
+  uint8_t state;
+  Step step;
+  Pending pending;
+  uint8_t resyncIndex;
+  bool probeDue;
+  uint32_t backoff;
+  FPM383FDeadline stepDeadline;
+  uint32_t downSince;
+  uint32_t lastProbeTime;
+  uint32_t lastUpdate;
+  bool started;
+  FPM383FHealthStats stats;
+
+  void account(uint32_t now);
+  void heartbeat(uint32_t now);
+  void trip(uint32_t now);
+  void recover(uint32_t now);
+  void complete(uint32_t now, bool answered);
+  void probed(uint32_t now, bool answered);
+  void settle(uint32_t now, uint32_t ms);
+  void nextStep(uint32_t now);
+  void recovered(uint32_t now);
+  bool start(Pending kind, uint8_t cmd1, uint8_t cmd2, uint8_t* data = nullptr, uint16_t dataLen = 0);
+  bool reopen(uint32_t rate);
+  bool nextResyncIndex(uint8_t from);
+};
+
+#endif
@@ -0,0 +1,358 @@
+#include "FPM383FJournal.h"
+
+#define FP_JOURNAL_MAGIC 0xA0     // high nibble of the type byte
+#define FP_JOURNAL_CRC_OFFSET 9
+#define FP_JOURNAL_DRIVER_ERRORS 0xFF00   // stored form of FP_ERROR_CIRCUIT_OPEN and up
+#define FP_JOURNAL_OTHER_ERROR 0xFFFF     // stored form of codes that do not fit
+
+FPM383FJournal::FPM383FJournal(FPM383F& driver, FPM383FJournalStorage& storage)
+  : driver(driver), storage(storage) {
+  slotCount = 0;
+  slotsPerBlock = 0;
+  pageSlot = 0;
+  pageWritten = 0;
+  pageFill = 0;
+  eraseNeeded = false;
+  nextSequence = 0;
+  oldestSequence = 0;
+  oldestSlot = 0;
+  pendingSince = 0;
+  dropped = 0;
+  pageWrites = 0;
+  erases = 0;
+  ready = false;
+}
+
+bool FPM383FJournal::begin() {
+  uint32_t size = storage.getSize();
+  uint32_t eraseSize = storage.getEraseSize();
+
+  ready = false;
+  if (eraseSize == 0 || eraseSize % FP_JOURNAL_PAGE_SIZE != 0 ||
+      size % eraseSize != 0 || size < 2 * eraseSize) {
+    return false;
+  }
+
+  slotCount = size / FP_JOURNAL_RECORD_SIZE;
+  slotsPerBlock = eraseSize / FP_JOURNAL_RECORD_SIZE;
+
+  // Find the newest and oldest records
+  bool found = false;
+  uint32_t newestSlot = 0;
+  FPM383FJournalEvent event;
+  for (uint32_t first = 0; first < slotCount; first += FP_JOURNAL_RECORDS_PER_PAGE) {
+    if (!storage.read(first * FP_JOURNAL_RECORD_SIZE, page, FP_JOURNAL_PAGE_SIZE)) {
+      return false;
+    }
+    for (uint8_t i = 0; i < FP_JOURNAL_RECORDS_PER_PAGE; i++) {
+      if (!decode(page + i * FP_JOURNAL_RECORD_SIZE, event)) continue;
+
+      if (!found || event.sequence >= nextSequence) {
+        nextSequence = event.sequence + 1;
+        newestSlot = first + i;
+      }
+      if (!found || event.sequence < oldestSequence) {
+        oldestSequence = event.sequence;
+        oldestSlot = first + i;
+      }
+      found = true;
+    }
+  }
+
+  if (!found) {
+    nextSequence = 0;
+    oldestSequence = 0;
+    oldestSlot = 0;
+    startPage(0);
+  } else {
+    uint32_t head = (newestSlot + 1) % slotCount;
+    if (head % FP_JOURNAL_RECORDS_PER_PAGE == 0) {
+      startPage(head);
+    } else {
+      // Continue in the partially written page, skipping torn slots
+      pageSlot = head - head % FP_JOURNAL_RECORDS_PER_PAGE;
+      if (!storage.read(pageSlot * FP_JOURNAL_RECORD_SIZE, page, FP_JOURNAL_PAGE_SIZE)) {
+        return false;
+      }
+      pageWritten = head - pageSlot;
+      while (pageWritten < FP_JOURNAL_RECORDS_PER_PAGE &&
+             !isErased(page + pageWritten * FP_JOURNAL_RECORD_SIZE)) {
+        pageWritten++;
+      }
+      pageFill = pageWritten;
+      eraseNeeded = false;
+      if (pageWritten == FP_JOURNAL_RECORDS_PER_PAGE) {
+        startPage((pageSlot + FP_JOURNAL_RECORDS_PER_PAGE) % slotCount);
+      }
+    }
+  }
+
+  ready = true;
+  return true;
+}
+
+bool FPM383FJournal::format() {
+  uint32_t eraseSize = storage.getEraseSize();
+  uint32_t size = storage.getSize();
+
+  if (eraseSize == 0) return false;
+  for (uint32_t address = 0; address < size; address += eraseSize) {
+    if (!storage.erase(address)) return false;
+    erases++;
+  }
+  return begin();
+}
+
+bool FPM383FJournal::log(uint8_t type, uint16_t fingerprintId, uint16_t score, uint32_t errorCode) {
+  if (!ready || pageFill >= FP_JOURNAL_RECORDS_PER_PAGE) {
+    dropped++;
+    return false;
+  }
+
+  FPM383FJournalEvent event;
+  event.sequence = nextSequence++;
+  event.timestamp = driver.getClock().now();
+  event.type = type;
+  event.fingerprintId = fingerprintId;
+  event.score = score;
+  event.errorCode = errorCode;
+
+  if (pageFill == pageWritten) {
+    pendingSince = event.timestamp;
+  }
+  encode(event, page + pageFill * FP_JOURNAL_RECORD_SIZE);
+  pageFill++;
+  return true;
+}
+
+bool FPM383FJournal::logMatch(const FingerprintMatchResult& result, uint32_t errorCode) {
+  if (errorCode != FP_ERROR_SUCCESS) {
+    return log(FP_JOURNAL_ERROR, 0, 0, errorCode);
+  }
+  return log(result.matched ? FP_JOURNAL_MATCH : FP_JOURNAL_NO_MATCH,
+             result.matched ? result.fingerprintId : 0, result.matchScore, errorCode);
+}
+
+bool FPM383FJournal::logVerify(uint16_t fingerprintId, const FingerprintMatchResult& result, uint32_t errorCode) {
+  if (errorCode != FP_ERROR_SUCCESS) {
+    return log(FP_JOURNAL_ERROR, fingerprintId, 0, errorCode);
+  }
+  return log(result.matched ? FP_JOURNAL_VERIFY : FP_JOURNAL_VERIFY_REJECT,
+             fingerprintId, result.matchScore, errorCode);
+}
+
+bool FPM383FJournal::logEnroll(uint16_t fingerprintId, bool success, uint32_t errorCode) {
+  return log(success ? FP_JOURNAL_ENROLL : FP_JOURNAL_ENROLL_FAILED, fingerprintId, 0, errorCode);
+}
+
+bool FPM383FJournal::update() {
+  if (!ready) return false;
+
+  if (pageFill == FP_JOURNAL_RECORDS_PER_PAGE) {
+    return flush();
+  }
+  if (pageFill > pageWritten && driver.getClock().now() - pendingSince >= FP_JOURNAL_FLUSH_INTERVAL) {
+    return flush();
+  }
+  return true;
+}
+
+bool FPM383FJournal::flush() {
+  if (!ready) return false;
+  if (pageFill == pageWritten) return true;
+
+  if (eraseNeeded) {
+    if (!storage.erase(pageSlot * FP_JOURNAL_RECORD_SIZE)) return false;
+    erases++;
+    eraseNeeded = false;
+  }
+
+  // Only the new slots; the rest of the page is already programmed or erased
+  uint16_t offset = pageWritten * FP_JOURNAL_RECORD_SIZE;
+  uint16_t length = (pageFill - pageWritten) * FP_JOURNAL_RECORD_SIZE;
+  if (!storage.write(pageSlot * FP_JOURNAL_RECORD_SIZE + offset, page + offset, length)) {
+    return false;
+  }
+  pageWrites++;
+  pageWritten = pageFill;
+
+  if (pageWritten == FP_JOURNAL_RECORDS_PER_PAGE) {
+    startPage((pageSlot + FP_JOURNAL_RECORDS_PER_PAGE) % slotCount);
+  }
+  return true;
+}
+
+uint16_t FPM383FJournal::read(FPM383FJournalCursor& cursor, FPM383FJournalEvent* events, uint16_t maxEvents) {
+  if (!ready || maxEvents == 0 || cursor.sequence >= nextSequence) {
+    return 0;
+  }
+
+  FPM383FJournalEvent event;
+  uint32_t slot = cursor.slot;
+  if (cursor.sequence <= oldestSequence || slot >= slotCount ||
+      !readSlot(slot, event) || event.sequence != cursor.sequence) {
+    // Overwritten, restored from elsewhere or moved by a skipped slot
+    slot = oldestSlot;
+  }
+
+  // With the last page of an erase block full in RAM every slot holds a
+  // record and head == slot; scan the whole ring then
+  uint32_t head = (pageSlot + pageFill) % slotCount;
+  uint32_t span = (head + slotCount - slot) % slotCount;
+  if (span == 0) span = slotCount;
+
+  uint16_t count = 0;
+  while (count < maxEvents && span-- > 0) {
+    if (readSlot(slot, event) && event.sequence >= cursor.sequence) {
+      events[count++] = event;
+      cursor.sequence = event.sequence + 1;
+    }
+    slot = (slot + 1) % slotCount;
+  }
+
+  cursor.slot = slot;
+  return count;
+}
+
+FPM383FJournalCursor FPM383FJournal::getOldestCursor() {
+  FPM383FJournalCursor cursor;
+  cursor.sequence = oldestSequence;
+  cursor.slot = oldestSlot;
+  return cursor;
+}
+
+uint32_t FPM383FJournal::getNextSequence() {
+  return nextSequence;
+}
+
+uint32_t FPM383FJournal::getOldestSequence() {
+  return oldestSequence;
+}
+
+uint16_t FPM383FJournal::getPendingCount() {
+  return pageFill - pageWritten;
+}
+
+uint32_t FPM383FJournal::getDroppedCount() {
+  return dropped;
+}
+
+uint32_t FPM383FJournal::getPageWrites() {
+  return pageWrites;
+}
+
+uint32_t FPM383FJournal::getErases() {
+  return erases;
+}
+
+void FPM383FJournal::startPage(uint32_t slot) {
+  pageSlot = slot;
+  pageWritten = 0;
+  pageFill = 0;
+  memset(page, 0xFF, FP_JOURNAL_PAGE_SIZE);
+
+  if (slot % slotsPerBlock != 0) {
+    eraseNeeded = false;
+    return;
+  }
+
+  // Entering an erase block: its old records are dropped now and the block is
+  // erased right before the first write
+  eraseNeeded = true;
+  uint32_t blockEnd = (slot + slotsPerBlock) % slotCount;
+  if (oldestSequence == nextSequence || oldestSlot < slot || oldestSlot >= slot + slotsPerBlock) {
+    return;
+  }
+
+  FPM383FJournalEvent event;
+  for (uint32_t next = blockEnd; next != slot; next = (next + 1) % slotCount) {
+    if (readSlot(next, event)) {
+      oldestSequence = event.sequence;
+      oldestSlot = next;
+      return;
+    }
+  }
+  oldestSequence = nextSequence;
+  oldestSlot = slot;
+}
+
+bool FPM383FJournal::readSlot(uint32_t slot, FPM383FJournalEvent& event) {
+  if (slot >= pageSlot && slot < pageSlot + FP_JOURNAL_RECORDS_PER_PAGE) {
+    return slot - pageSlot < pageFill && decode(page + (slot - pageSlot) * FP_JOURNAL_RECORD_SIZE, event);
+  }
+
+  uint8_t data[FP_JOURNAL_RECORD_SIZE];
+  return storage.read(slot * FP_JOURNAL_RECORD_SIZE, data, FP_JOURNAL_RECORD_SIZE) && decode(data, event);
+}
+
+bool FPM383FJournal::decode(const uint8_t* data, FPM383FJournalEvent& event) {
+  if ((data[8] & 0xF0) != FP_JOURNAL_MAGIC || crc8(data) != data[FP_JOURNAL_CRC_OFFSET]) {
+    return false;
+  }
+
+  event.sequence = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+  event.timestamp = ((uint32_t)data[4] << 24) | ((uint32_t)data[5] << 16) | ((uint32_t)data[6] << 8) | data[7];
+  event.type = data[8] & 0x0F;
+  event.fingerprintId = ((uint16_t)data[10] << 8) | data[11];
+  event.score = ((uint16_t)data[12] << 8) | data[13];
+  event.errorCode = unpackError(((uint16_t)data[14] << 8) | data[15]);
+  return true;
+}
+
+void FPM383FJournal::encode(const FPM383FJournalEvent& event, uint8_t* data) {
+  data[0] = event.sequence >> 24;
+  data[1] = event.sequence >> 16;
+  data[2] = event.sequence >> 8;
+  data[3] = event.sequence;
+  data[4] = event.timestamp >> 24;
+  data[5] = event.timestamp >> 16;
+  data[6] = event.timestamp >> 8;
+  data[7] = event.timestamp;
+  data[8] = FP_JOURNAL_MAGIC | (event.type & 0x0F);
+  data[10] = event.fingerprintId >> 8;
+  data[11] = event.fingerprintId;
+  data[12] = event.score >> 8;
+  data[13] = event.score;
+  uint16_t errorCode = packError(event.errorCode);
+  data[14] = errorCode >> 8;
+  data[15] = errorCode;
+  data[FP_JOURNAL_CRC_OFFSET] = crc8(data);
+}
+
+uint16_t FPM383FJournal::packError(uint32_t errorCode) {
+  if (errorCode < FP_JOURNAL_DRIVER_ERRORS) {
+    return errorCode;
+  }
+  if (errorCode >= FP_ERROR_CIRCUIT_OPEN &&
+      errorCode - FP_ERROR_CIRCUIT_OPEN < FP_JOURNAL_OTHER_ERROR - FP_JOURNAL_DRIVER_ERRORS) {
+    return FP_JOURNAL_DRIVER_ERRORS + (errorCode - FP_ERROR_CIRCUIT_OPEN);
+  }
+  return FP_JOURNAL_OTHER_ERROR;
+}
+
+uint32_t FPM383FJournal::unpackError(uint16_t stored) {
+  if (stored < FP_JOURNAL_DRIVER_ERRORS || stored == FP_JOURNAL_OTHER_ERROR) {
+    return stored;
+  }
+  return FP_ERROR_CIRCUIT_OPEN + (stored - FP_JOURNAL_DRIVER_ERRORS);
+}
+
+bool FPM383FJournal::isErased(const uint8_t* data) {
+  for (uint8_t i = 0; i < FP_JOURNAL_RECORD_SIZE; i++) {
+    if (data[i] != 0xFF) return false;
+  }
+  return true;
+}
+
+// CRC-8 (polynomial 0x07) over the record without its CRC byte
+uint8_t FPM383FJournal::crc8(const uint8_t* data) {
+  uint8_t crc = 0;
+  for (uint8_t i = 0; i < FP_JOURNAL_RECORD_SIZE; i++) {
+    if (i == FP_JOURNAL_CRC_OFFSET) continue;
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+  return crc;
+}
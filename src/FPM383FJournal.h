@@ -0,0 +1,175 @@
+#ifndef FPM383F_JOURNAL_H
+#define FPM383F_JOURNAL_H
+
+// Append-only access-event journal on flash or SD. log() only copies the
+// event into a RAM page buffer, so the unlock path never waits for storage;
+// update() (from loop()) writes the buffer out one page at a time, or earlier
+// if events have been pending for FP_JOURNAL_FLUSH_INTERVAL.
+//
+// Storage is used as a ring of fixed-size records:
+//   - each record slot is programmed once per pass; partially filled pages
+//     are completed by programming only their empty slots, so NOR flash never
+//     needs a read-modify-write
+//   - an erase block is erased only when the write position enters it, which
+//     drops its oldest records and spreads erases evenly over the ring
+//   - records carry a sequence number and a CRC-8; begin() scans the storage
+//     to find the newest and oldest records and skips torn writes
+//
+// Upload with a cursor: read() returns events in order starting at the
+// cursor and advances it; persist the cursor to resume after a reboot.
+//
+// Record layout (16 bytes, big-endian):
+//   sequence (4), timestamp (4), type (1), CRC-8 (1), fingerprint id (2),
+//   score (2), error code (2)
+//
+// Module error codes below 0xFF00 are stored as is. Driver codes from
+// 0x00010000 (FP_ERROR_CIRCUIT_OPEN) are stored as 0xFF00 plus their offset,
+// so they read back unchanged; anything else is stored as 0xFFFF.
+
+#include "FPM383F.h"
+
+#ifndef FP_JOURNAL_PAGE_SIZE
+#if defined(__AVR__)
+#define FP_JOURNAL_PAGE_SIZE 64
+#else
+#define FP_JOURNAL_PAGE_SIZE 256
+#endif
+#endif
+#ifndef FP_JOURNAL_FLUSH_INTERVAL
+#define FP_JOURNAL_FLUSH_INTERVAL 5000
+#endif
+#define FP_JOURNAL_RECORD_SIZE 16
+#define FP_JOURNAL_RECORDS_PER_PAGE (FP_JOURNAL_PAGE_SIZE / FP_JOURNAL_RECORD_SIZE)
+
+// Event types
+#define FP_JOURNAL_MATCH 0x01
+#define FP_JOURNAL_NO_MATCH 0x02
+#define FP_JOURNAL_VERIFY 0x03
+#define FP_JOURNAL_VERIFY_REJECT 0x04
+#define FP_JOURNAL_ENROLL 0x05
+#define FP_JOURNAL_ENROLL_FAILED 0x06
+#define FP_JOURNAL_ERROR 0x07
+
+struct FPM383FJournalEvent {
+  uint32_t sequence;
+  uint32_t timestamp;      // driver clock (ms)
+  uint8_t type;
+  uint16_t fingerprintId;
+  uint16_t score;
+  uint32_t errorCode;
+};
+
+struct FPM383FJournalCursor {
+  uint32_t sequence;       // next sequence number to read
+  uint32_t slot;           // where it is expected; corrected by read()
+};
+
+// Backing store. Addresses are byte offsets; size and erase size must be
+// multiples of FP_JOURNAL_PAGE_SIZE, and the journal needs at least two erase
+// blocks. Storage without a native erase (SD files, FRAM) must fill the block
+// with 0xFF, otherwise old records would reappear after a reboot.
+class FPM383FJournalStorage {
+public:
+  virtual ~FPM383FJournalStorage() {}
+
+  virtual uint32_t getSize() = 0;
+  virtual uint32_t getEraseSize() = 0;
+  virtual bool read(uint32_t address, uint8_t* data, uint16_t length) = 0;
+  virtual bool write(uint32_t address, const uint8_t* data, uint16_t length) = 0;
+  virtual bool erase(uint32_t address) = 0;
+};
+
+// RAM storage that behaves like NOR flash (erase sets 0xFF, programming can
+// only clear bits); for host harnesses.
+class FPM383FMemoryJournalStorage : public FPM383FJournalStorage {
+public:
+  FPM383FMemoryJournalStorage(uint8_t* buffer, uint32_t size, uint32_t eraseSize)
+    : buffer(buffer), size(size), eraseSize(eraseSize) {
+    memset(buffer, 0xFF, size);
+  }
+
+  uint32_t getSize() { return size; }
+  uint32_t getEraseSize() { return eraseSize; }
+
+  bool read(uint32_t address, uint8_t* data, uint16_t length) {
+    memcpy(data, buffer + address, length);
+    return true;
+  }
+
+  bool write(uint32_t address, const uint8_t* data, uint16_t length) {
+    for (uint16_t i = 0; i < length; i++) {
+      buffer[address + i] &= data[i];
+    }
+    return true;
+  }
+
+  bool erase(uint32_t address) {
+    memset(buffer + address - address % eraseSize, 0xFF, eraseSize);
+    return true;
+  }
+
+private:
+  uint8_t* buffer;
+  uint32_t size;
+  uint32_t eraseSize;
+};
+
+class FPM383FJournal {
+public:
+  FPM383FJournal(FPM383F& driver, FPM383FJournalStorage& storage);
+
+  // Scans the storage; must be called before logging
+  bool begin();
+  bool format();  // erases everything, e.g. a new SD file with unrelated data
+
+  // Never touch storage; return false if the page buffer is full
+  bool log(uint8_t type, uint16_t fingerprintId, uint16_t score, uint32_t errorCode);
+  bool logMatch(const FingerprintMatchResult& result, uint32_t errorCode = FP_ERROR_SUCCESS);
+  bool logVerify(uint16_t fingerprintId, const FingerprintMatchResult& result, uint32_t errorCode = FP_ERROR_SUCCESS);
+  bool logEnroll(uint16_t fingerprintId, bool success, uint32_t errorCode = FP_ERROR_SUCCESS);
+
+  // Writes a full page, or pending events older than the flush interval
+  bool update();
+  bool flush();
+
+  // Cursor-based bulk read, oldest first
+  uint16_t read(FPM383FJournalCursor& cursor, FPM383FJournalEvent* events, uint16_t maxEvents);
+  FPM383FJournalCursor getOldestCursor();
+
+  uint32_t getNextSequence();
+  uint32_t getOldestSequence();
+  uint16_t getPendingCount();   // logged but not yet on storage
+  uint32_t getDroppedCount();   // events lost because the page buffer was full
+  uint32_t getPageWrites();
+  uint32_t getErases();
+
+private:
+  FPM383F& driver;
+  FPM383FJournalStorage& storage;
+  uint32_t slotCount;
+  uint32_t slotsPerBlock;
+  uint8_t page[FP_JOURNAL_PAGE_SIZE];
+  uint32_t pageSlot;          // first slot of the buffered page
+  uint8_t pageWritten;        // slots of the page already on storage (or skipped)
+  uint8_t pageFill;           // slots of the page in use
+  bool eraseNeeded;           // page starts an erase block not erased yet
+  uint32_t nextSequence;
+  uint32_t oldestSequence;
+  uint32_t oldestSlot;
+  uint32_t pendingSince;
+  uint32_t dropped;
+  uint32_t pageWrites;
+  uint32_t erases;
+  bool ready;
+
+  void startPage(uint32_t slot);
+  bool readSlot(uint32_t slot, FPM383FJournalEvent& event);
+  static bool decode(const uint8_t* data, FPM383FJournalEvent& event);
+  static void encode(const FPM383FJournalEvent& event, uint8_t* data);
+  static uint16_t packError(uint32_t errorCode);
+  static uint32_t unpackError(uint16_t stored);
+  static bool isErased(const uint8_t* data);
+  static uint8_t crc8(const uint8_t* data);
+};
+
+#endif
@@ -0,0 +1,240 @@
+#include "FPM383FLed.h"
+
+FPM383FLed::FPM383FLed(FPM383F& driver) : driver(driver) {
+  memset(desired, 0, sizeof(desired));
+  memset(applied, 0, sizeof(applied));
+  memset(sending, 0, sizeof(sending));
+  dirty = false;
+  inFlight = false;
+  appliedValid = false;
+  appliedExpires = false;
+  cycleCount = 0;
+  cycleIndex = 0;
+  cycleRepeats = 0;
+  cycleRemaining = 0;
+  cycleStepMs = 0;
+  cycling = false;
+  sentCount = 0;
+  coalescedCount = 0;
+  lastError = FP_ERROR_SUCCESS;
+}
+
+void FPM383FLed::set(uint8_t mode, uint8_t color, uint8_t param1, uint8_t param2, uint8_t param3) {
+  cycling = false;
+  request(mode, color, param1, param2, param3);
+}
+
+void FPM383FLed::solid(uint8_t color) {
+  set(FP_LED_MODE_ON, color);
+}
+
+void FPM383FLed::off() {
+  set(FP_LED_MODE_OFF, FP_LED_OFF);
+}
+
+void FPM383FLed::blink(uint8_t color, uint16_t onMs, uint16_t offMs, uint8_t count) {
+  set(FP_LED_MODE_BLINK, color, toBlinkUnits(onMs), toBlinkUnits(offMs), count);
+}
+
+void FPM383FLed::breathe(uint8_t color, uint8_t maxDuty, uint8_t minDuty, uint8_t rate) {
+  set(FP_LED_MODE_PWM, color, maxDuty, minDuty, rate);
+}
+
+void FPM383FLed::cycle(const uint8_t* colors, uint8_t count, uint16_t stepMs, uint8_t repeats) {
+  if (count == 0) {
+    off();
+    return;
+  }
+  if (count == 1) {
+    solid(colors[0]);
+    return;
+  }
+
+  // A colour alternating with off is a native blink
+  bool blinkable = count == 2 && stepMs <= 255 * FP_LED_BLINK_UNIT_MS &&
+                   ((colors[0] == FP_LED_OFF) != (colors[1] == FP_LED_OFF));
+  if (blinkable) {
+    blink(colors[0] != FP_LED_OFF ? colors[0] : colors[1], stepMs, stepMs, repeats);
+    return;
+  }
+
+  if (count > FP_LED_MAX_CYCLE_COLORS) {
+    count = FP_LED_MAX_CYCLE_COLORS;
+  }
+  memcpy(cycleColors, colors, count);
+  cycleCount = count;
+  cycleIndex = 0;
+  cycleRepeats = repeats;
+  cycleRemaining = repeats;
+  cycleStepMs = stepMs;
+  cycling = true;
+  cycleDeadline = FPM383FDeadline(driver.getClock().now(), stepMs);
+  request(FP_LED_MODE_ON, cycleColors[0], 0, 0, 0);
+}
+
+bool FPM383FLed::update() {
+  uint32_t now = driver.getClock().now();
+
+  expireApplied(now);
+  if (cycling && cycleDeadline.expired(now)) {
+    advanceCycle(now);
+  }
+
+  if (inFlight) {
+    uint8_t status = driver.pollRequest();
+    if (status == FP_REQUEST_PENDING) {
+      return true;
+    }
+    if (!complete(status)) {
+      return false;
+    }
+  }
+
+  if (!dirty || driver.isRequestPending()) {
+    return true;
+  }
+  return send();
+}
+
+bool FPM383FLed::flush() {
+  bool ok = finish();
+  expireApplied(driver.getClock().now());
+
+  if (!dirty) {
+    return ok;
+  }
+  if (driver.isRequestPending()) {
+    lastError = FP_ERROR_SYSTEM_BUSY;
+    return false;
+  }
+  return send() && finish();
+}
+
+void FPM383FLed::invalidate() {
+  appliedValid = false;
+  appliedExpires = false;
+  dirty = true;
+}
+
+bool FPM383FLed::isPending() {
+  return dirty || inFlight;
+}
+
+uint32_t FPM383FLed::getSentCount() {
+  return sentCount;
+}
+
+uint32_t FPM383FLed::getCoalescedCount() {
+  return coalescedCount;
+}
+
+uint32_t FPM383FLed::getLastError() {
+  return lastError;
+}
+
+void FPM383FLed::request(uint8_t mode, uint8_t color, uint8_t param1, uint8_t param2, uint8_t param3) {
+  uint8_t state[5] = {mode, color, param1, param2, param3};
+
+  expireApplied(driver.getClock().now());
+
+  // The previous request is superseded before it reached the module
+  if (dirty) {
+    coalescedCount++;
+  }
+
+  // Compare with the frame in flight, which is about to become the LED state
+  memcpy(desired, state, sizeof(desired));
+  if (inFlight) {
+    dirty = memcmp(desired, sending, sizeof(sending)) != 0;
+  } else {
+    dirty = !(appliedValid && memcmp(desired, applied, sizeof(applied)) == 0);
+  }
+  if (!dirty) {
+    coalescedCount++;
+  }
+}
+
+// A finite blink ends on its own, after which repeating it is not redundant
+void FPM383FLed::expireApplied(uint32_t now) {
+  if (appliedExpires && appliedDeadline.expired(now)) {
+    appliedValid = false;
+    appliedExpires = false;
+  }
+}
+
+void FPM383FLed::advanceCycle(uint32_t now) {
+  cycleIndex++;
+  if (cycleIndex >= cycleCount) {
+    cycleIndex = 0;
+    if (cycleRepeats > 0 && --cycleRemaining == 0) {
+      cycling = false;
+      request(FP_LED_MODE_OFF, FP_LED_OFF, 0, 0, 0);
+      return;
+    }
+  }
+
+  cycleDeadline = FPM383FDeadline(now, cycleStepMs);
+  request(FP_LED_MODE_ON, cycleColors[cycleIndex], 0, 0, 0);
+}
+
+bool FPM383FLed::send() {
+  if (!driver.beginRequest(FP_CMD_SYSTEM_0, FP_CMD_SET_LED, desired, sizeof(desired))) {
+    // Stays queued for the next update()
+    lastError = driver.getLastError();
+    return false;
+  }
+
+  memcpy(sending, desired, sizeof(sending));
+  inFlight = true;
+  dirty = false;
+  sentCount++;
+  return true;
+}
+
+bool FPM383FLed::complete(uint8_t status) {
+  inFlight = false;
+
+  uint32_t error = status == FP_REQUEST_DONE ? driver.getResponseError() : driver.getLastError();
+  if (error != FP_ERROR_SUCCESS) {
+    // The module state is unknown; resend the frame unless a newer request
+    // has replaced it
+    if (!dirty) {
+      memcpy(desired, sending, sizeof(desired));
+      dirty = true;
+    }
+    appliedValid = false;
+    appliedExpires = false;
+    lastError = error;
+    return false;
+  }
+
+  memcpy(applied, sending, sizeof(applied));
+  appliedValid = true;
+  appliedExpires = applied[0] == FP_LED_MODE_BLINK && applied[4] != 0;
+  if (appliedExpires) {
+    uint32_t duration = (uint32_t)(applied[2] + applied[3]) * FP_LED_BLINK_UNIT_MS * applied[4];
+    appliedDeadline = FPM383FDeadline(driver.getClock().now(), duration);
+  }
+  lastError = FP_ERROR_SUCCESS;
+  return true;
+}
+
+// Waits for the frame in flight, if any
+bool FPM383FLed::finish() {
+  if (!inFlight) {
+    return true;
+  }
+
+  uint8_t status;
+  while ((status = driver.pollRequest()) == FP_REQUEST_PENDING) {
+    driver.getClock().sleep(0);
+  }
+  return complete(status);
+}
+
+uint8_t FPM383FLed::toBlinkUnits(uint16_t ms) {
+  uint16_t units = (ms + FP_LED_BLINK_UNIT_MS / 2) / FP_LED_BLINK_UNIT_MS;
+  if (units == 0) return 1;
+  if (units > 255) return 255;
+  return (uint8_t)units;
+}
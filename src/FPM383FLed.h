@@ -0,0 +1,93 @@
+#ifndef FPM383F_LED_H
+#define FPM383F_LED_H
+
+// LED effect sequencer. Effects are requested at any time and applied from
+// update(), which is called from loop():
+//
+//   - requests that match the LED's current state are dropped, and requests
+//     made before the previous one was sent replace it, so at most one SET_LED
+//     frame is sent per update()
+//   - blink and breathe effects use the module's native FP_LED_MODE_BLINK and
+//     FP_LED_MODE_PWM modes and cost a single frame; only multi-colour cycles
+//     are timed by the host
+//   - frames are sent with beginRequest() only while no other non-blocking
+//     request is pending, and completed by later update() calls, so update()
+//     never waits for the module and an in-flight match (beginRequest(), the
+//     scanner or the coroutine layer) is never held up by the LED
+//   - a frame the module rejects or never answers is sent again by a later
+//     update(), unless a newer request has replaced it
+//
+// While an LED frame is in flight it owns the link: other beginRequest() calls
+// fail with FP_ERROR_SYSTEM_BUSY (the scanner waits for it instead). Read the
+// result of a completed non-blocking request before calling update(), and call
+// flush() before blocking driver calls, which waits for the frame in flight.
+// Call invalidate() after reset(), setSleepMode() or direct setLED() calls,
+// since the module's LED state is then unknown.
+
+#include "FPM383F.h"
+
+#ifndef FP_LED_MAX_CYCLE_COLORS
+#define FP_LED_MAX_CYCLE_COLORS 8
+#endif
+#define FP_LED_BLINK_UNIT_MS 10   // blink on/off times are sent in 10ms units
+
+class FPM383FLed {
+public:
+  FPM383FLed(FPM383F& driver);
+
+  // Effects; each replaces the current one
+  void set(uint8_t mode, uint8_t color, uint8_t param1 = 0, uint8_t param2 = 0, uint8_t param3 = 0);
+  void solid(uint8_t color);
+  void off();
+  void blink(uint8_t color, uint16_t onMs, uint16_t offMs, uint8_t count = 0);  // count 0 = forever
+  void breathe(uint8_t color, uint8_t maxDuty = 100, uint8_t minDuty = 0, uint8_t rate = 30);
+  void cycle(const uint8_t* colors, uint8_t count, uint16_t stepMs, uint8_t repeats = 0);  // repeats 0 = forever
+
+  // Advances host-timed effects, completes the frame in flight and starts the
+  // pending state if the link is idle. Never waits; returns false if a frame
+  // failed or could not be started.
+  bool update();
+  // Sends the pending state and waits for the module's reply, unless another
+  // non-blocking request is pending
+  bool flush();
+  void invalidate();
+
+  bool isPending();              // a state is waiting to be sent or confirmed
+  uint32_t getSentCount();       // SET_LED frames sent
+  uint32_t getCoalescedCount();  // requests that did not need a frame of their own
+  uint32_t getLastError();
+
+private:
+  FPM383F& driver;
+  uint8_t desired[5];   // mode, color, param1..3
+  uint8_t applied[5];
+  uint8_t sending[5];   // state of the frame in flight
+  bool dirty;
+  bool inFlight;
+  bool appliedValid;
+  bool appliedExpires;  // applied state is a finite blink
+  FPM383FDeadline appliedDeadline;
+
+  uint8_t cycleColors[FP_LED_MAX_CYCLE_COLORS];
+  uint8_t cycleCount;
+  uint8_t cycleIndex;
+  uint8_t cycleRepeats;
+  uint8_t cycleRemaining;
+  uint16_t cycleStepMs;
+  bool cycling;
+  FPM383FDeadline cycleDeadline;
+
+  uint32_t sentCount;
+  uint32_t coalescedCount;
+  uint32_t lastError;
+
+  void request(uint8_t mode, uint8_t color, uint8_t param1, uint8_t param2, uint8_t param3);
+  void expireApplied(uint32_t now);
+  void advanceCycle(uint32_t now);
+  bool send();
+  bool complete(uint8_t status);
+  bool finish();
+  static uint8_t toBlinkUnits(uint16_t ms);
+};
+
+#endif
@@ -0,0 +1,204 @@
+#include "FPM383FProtocol.h"
+#include <string.h>
+
+static const uint8_t frameHeader[8] = {FP_FRAME_HEADER_0, FP_FRAME_HEADER_1, FP_FRAME_HEADER_2,
+                                       FP_FRAME_HEADER_3, FP_FRAME_HEADER_4, FP_FRAME_HEADER_5,
+                                       FP_FRAME_HEADER_6, FP_FRAME_HEADER_7};
+
+uint8_t fpm383fChecksum(const uint8_t* data, uint16_t length) {
+  uint8_t sum = 0;
+  for (uint16_t i = 0; i < length; i++) {
+    sum += data[i];
+  }
+  return (uint8_t)((~sum) + 1);
+}
+
+// Sum of the eight frame header bytes
+#define FP_FRAME_HEADER_SUM 0x73
+
+uint8_t fpm383fFrameChecksum(uint16_t dataLength) {
+  uint8_t sum = FP_FRAME_HEADER_SUM;
+  sum += (dataLength >> 8) & 0xFF;
+  sum += dataLength & 0xFF;
+
+  return (uint8_t)((~sum) + 1);
+}
+
+uint16_t fpm383fEncodeFrame(uint8_t* out, uint16_t outSize, uint32_t password, uint8_t cmd1, uint8_t cmd2,
+                            const uint8_t* data, uint16_t dataLen) {
+  if (dataLen > 0xFFFF - 7 - FP_FRAME_OVERHEAD) return 0;
+
+  uint16_t totalLen = 7 + dataLen; // 4 bytes password + 2 bytes cmd + data + 1 byte checksum
+  if (outSize < FP_FRAME_OVERHEAD + totalLen) return 0;
+
+  uint16_t idx = 0;
+  for (int i = 0; i < 8; i++) {
+    out[idx++] = frameHeader[i];
+  }
+  out[idx++] = (totalLen >> 8) & 0xFF;
+  out[idx++] = totalLen & 0xFF;
+  out[idx++] = fpm383fFrameChecksum(totalLen);
+
+  uint8_t* appData = &out[idx];
+  out[idx++] = (password >> 24) & 0xFF;
+  out[idx++] = (password >> 16) & 0xFF;
+  out[idx++] = (password >> 8) & 0xFF;
+  out[idx++] = password & 0xFF;
+  out[idx++] = cmd1;
+  out[idx++] = cmd2;
+  if (data && dataLen > 0) {
+    memcpy(&out[idx], data, dataLen);
+    idx += dataLen;
+  }
+  out[idx] = fpm383fChecksum(appData, totalLen - 1);
+  idx++;
+
+  return idx;
+}
+
+bool fpm383fParseMatchResult(const uint8_t* data, uint16_t length, FingerprintMatchResult* result) {
+  if (length < 6) return false;
+
+  result->matchScore = (data[1] << 8) | data[2];
+  result->fingerprintId = (data[4] << 8) | data[5];
+  // A match is found if score > 0 and ID is valid (not 65535)
+  result->matched = (result->matchScore > 0 && result->fingerprintId != 65535);
+  return true;
+}
+
+bool fpm383fParseEnrollResult(const uint8_t* data, uint16_t length, FingerprintEnrollResult* result) {
+  if (length < 3) return false;
+
+  result->fingerprintId = (data[0] << 8) | data[1];
+  result->progress = data[2];
+  result->completed = (result->progress >= 100);
+  return true;
+}
+
+bool fpm383fParseTemplateCount(const uint8_t* data, uint16_t length, uint16_t* count) {
+  if (length < 2) return false;
+
+  *count = (data[0] << 8) | data[1];
+  return true;
+}
+
+bool fpm383fParseFlag(const uint8_t* data, uint16_t length, bool* flag) {
+  if (length < 1) return false;
+
+  *flag = (data[0] == 1);
+  return true;
+}
+
+bool fpm383fParseModuleId(const uint8_t* data, uint16_t length, char* out, size_t outSize) {
+  if (!out || outSize == 0) return false;
+  out[0] = '\0';
+  if (length < 16) return false;
+
+  size_t idx = 0;
+  for (int i = 0; i < 16 && idx + 1 < outSize; i++) {
+    if (data[i] != 0) {
+      out[idx++] = (char)data[i];
+    }
+  }
+  out[idx] = '\0';
+  return true;
+}
+
+FPM383FFrameDecoder::FPM383FFrameDecoder() {
+  reset();
+}
+
+void FPM383FFrameDecoder::reset() {
+  state = STATE_HEADER;
+  headerIdx = 0;
+  dataLength = 0;
+  bodyIdx = 0;
+  bodySum = 0;
+  decodeError = FP_ERROR_SUCCESS;
+}
+
+FPM383FFrameDecoder::Status FPM383FFrameDecoder::push(uint8_t byte) {
+  switch (state) {
+    case STATE_HEADER:
+      if (byte == frameHeader[headerIdx]) {
+        headerIdx++;
+      } else {
+        headerIdx = (byte == frameHeader[0]) ? 1 : 0;
+      }
+      if (headerIdx == 8) {
+        state = STATE_LENGTH_HIGH;
+      }
+      return NEED_MORE;
+
+    case STATE_LENGTH_HIGH:
+      dataLength = byte << 8;
+      state = STATE_LENGTH_LOW;
+      return NEED_MORE;
+
+    case STATE_LENGTH_LOW:
+      dataLength |= byte;
+      state = STATE_FRAME_CHECKSUM;
+      return NEED_MORE;
+
+    case STATE_FRAME_CHECKSUM:
+      if (byte != fpm383fFrameChecksum(dataLength)) {
+        reset();
+        decodeError = FP_ERROR_INVALID_DATA;
+        return FRAME_ERROR;
+      }
+      if (dataLength < FP_RESPONSE_MIN_LENGTH || dataLength > FP_MAX_FRAME_DATA) {
+        reset();
+        decodeError = FP_ERROR_INVALID_LENGTH;
+        return FRAME_ERROR;
+      }
+      bodyIdx = 0;
+      bodySum = 0;
+      state = STATE_BODY;
+      return NEED_MORE;
+
+    case STATE_BODY:
+      buffer[bodyIdx++] = byte;
+      if (bodyIdx < dataLength) {
+        bodySum += byte;
+        return NEED_MORE;
+      }
+      state = STATE_HEADER;
+      headerIdx = 0;
+      if (byte != (uint8_t)((~bodySum) + 1)) {
+        decodeError = FP_ERROR_INVALID_DATA;
+        return FRAME_ERROR;
+      }
+      return FRAME_READY;
+  }
+
+  reset();
+  return NEED_MORE;
+}
+
+uint8_t FPM383FFrameDecoder::getCmd1() const {
+  return buffer[4];
+}
+
+uint8_t FPM383FFrameDecoder::getCmd2() const {
+  return buffer[5];
+}
+
+uint32_t FPM383FFrameDecoder::getErrorCode() const {
+  return ((uint32_t)buffer[6] << 24) | ((uint32_t)buffer[7] << 16) | ((uint32_t)buffer[8] << 8) | buffer[9];
+}
+
+const uint8_t* FPM383FFrameDecoder::getPayload() const {
+  return &buffer[10];
+}
+
+uint16_t FPM383FFrameDecoder::getPayloadLength() const {
+  return dataLength - FP_RESPONSE_MIN_LENGTH;
+}
+
+uint16_t FPM383FFrameDecoder::getFrameLength() const {
+  return FP_FRAME_OVERHEAD + dataLength;
+}
+
+uint32_t FPM383FFrameDecoder::getDecodeError() const {
+  return decodeError;
+}
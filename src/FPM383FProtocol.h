@@ -0,0 +1,212 @@
+#ifndef FPM383F_PROTOCOL_H
+#define FPM383F_PROTOCOL_H
+
+// Protocol definitions and frame codec shared by the Arduino driver and
+// host-side tools. Must not depend on Arduino headers.
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Frame header
+#define FP_FRAME_HEADER_0 0xF1
+#define FP_FRAME_HEADER_1 0x1F
+#define FP_FRAME_HEADER_2 0xE2
+#define FP_FRAME_HEADER_3 0x2E
+#define FP_FRAME_HEADER_4 0xB6
+#define FP_FRAME_HEADER_5 0x6B
+#define FP_FRAME_HEADER_6 0xA8
+#define FP_FRAME_HEADER_7 0x8A
+
+// Command categories
+#define FP_CMD_FINGERPRINT_0 0x01
+#define FP_CMD_SYSTEM_0 0x02
+#define FP_CMD_MAINTENANCE_0 0x03
+
+// Fingerprint commands
+#define FP_CMD_ENROLL 0x11
+#define FP_CMD_QUERY_ENROLL 0x12
+#define FP_CMD_SAVE_TEMPLATE 0x13
+#define FP_CMD_QUERY_SAVE 0x14
+#define FP_CMD_CANCEL 0x15
+#define FP_CMD_UPDATE_FEATURE 0x16
+#define FP_CMD_QUERY_UPDATE 0x17
+#define FP_CMD_AUTO_ENROLL 0x18
+#define FP_CMD_MATCH 0x21
+#define FP_CMD_QUERY_MATCH 0x22
+#define FP_CMD_MATCH_SYNC 0x23
+#define FP_CMD_DELETE 0x31
+#define FP_CMD_QUERY_DELETE 0x32
+#define FP_CMD_CHECK_ID_EXIST 0x33
+#define FP_CMD_GET_STORAGE_INFO 0x34
+#define FP_CMD_CHECK_FINGER_STATUS 0x35
+#define FP_CMD_DELETE_SYNC 0x36
+#define FP_CMD_CONFIRM_ENROLL 0x41
+#define FP_CMD_QUERY_CONFIRM 0x42
+
+// Template transfer commands. These are not part of the V1.2 protocol document;
+// override them if the module firmware uses different opcodes.
+#ifndef FP_CMD_UPLOAD_TEMPLATE_INFO
+#define FP_CMD_UPLOAD_TEMPLATE_INFO 0x51    // id -> template size
+#endif
+#ifndef FP_CMD_UPLOAD_TEMPLATE_DATA
+#define FP_CMD_UPLOAD_TEMPLATE_DATA 0x52    // id, offset, length -> template bytes
+#endif
+#ifndef FP_CMD_DOWNLOAD_TEMPLATE_INFO
+#define FP_CMD_DOWNLOAD_TEMPLATE_INFO 0x53  // id, template size
+#endif
+#ifndef FP_CMD_DOWNLOAD_TEMPLATE_DATA
+#define FP_CMD_DOWNLOAD_TEMPLATE_DATA 0x54  // id, offset, template bytes
+#endif
+
+// 1:1 verification against a single template; same response layout as
+// FP_CMD_MATCH_SYNC. Not part of the V1.2 protocol document either.
+#ifndef FP_CMD_VERIFY_SYNC
+#define FP_CMD_VERIFY_SYNC 0x25             // id -> match result
+#endif
+
+// System commands
+#define FP_CMD_SET_PASSWORD 0x01
+#define FP_CMD_RESET_MODULE 0x02
+#define FP_CMD_GET_TEMPLATE_COUNT 0x03
+#define FP_CMD_GET_GAIN 0x09
+#define FP_CMD_GET_THRESHOLD 0x0B
+#define FP_CMD_SET_SLEEP_MODE 0x0C
+#define FP_CMD_SET_ENROLL_COUNT 0x0D
+#define FP_CMD_SET_LED 0x0F
+#define FP_CMD_GET_POLICY 0xFB
+#define FP_CMD_SET_POLICY 0xFC
+
+// Maintenance commands
+#define FP_CMD_GET_MODULE_ID 0x01
+#define FP_CMD_HEARTBEAT 0x03
+#define FP_CMD_SET_BAUDRATE 0x04
+#define FP_CMD_SET_COMM_PASSWORD 0x05
+
+// Error codes
+#define FP_ERROR_SUCCESS 0x00000000
+#define FP_ERROR_UNKNOWN_CMD 0x00000001
+#define FP_ERROR_INVALID_LENGTH 0x00000002
+#define FP_ERROR_INVALID_DATA 0x00000003
+#define FP_ERROR_SYSTEM_BUSY 0x00000004
+#define FP_ERROR_NO_REQUEST 0x00000005
+#define FP_ERROR_SOFTWARE_ERROR 0x00000006
+#define FP_ERROR_HARDWARE_ERROR 0x00000007
+#define FP_ERROR_TIMEOUT 0x00000008
+#define FP_ERROR_EXTRACTION_ERROR 0x00000009
+#define FP_ERROR_TEMPLATE_EMPTY 0x0000000A
+#define FP_ERROR_STORAGE_FULL 0x0000000B
+#define FP_ERROR_WRITE_FAILED 0x0000000C
+#define FP_ERROR_READ_FAILED 0x0000000D
+#define FP_ERROR_POOR_IMAGE 0x0000000E
+#define FP_ERROR_DUPLICATE 0x0000000F
+#define FP_ERROR_SMALL_AREA 0x00000010
+
+// LED colors
+#define FP_LED_OFF 0x00
+#define FP_LED_GREEN 0x01
+#define FP_LED_RED 0x02
+#define FP_LED_RED_GREEN 0x03
+#define FP_LED_BLUE 0x04
+#define FP_LED_RED_BLUE 0x05
+#define FP_LED_GREEN_BLUE 0x06
+#define FP_LED_ALL_COLORS 0x07
+
+// LED control modes
+#define FP_LED_MODE_OFF 0x00
+#define FP_LED_MODE_ON 0x01
+#define FP_LED_MODE_AUTO 0x02
+#define FP_LED_MODE_PWM 0x03
+#define FP_LED_MODE_BLINK 0x04
+
+// Frame layout
+#define FP_FRAME_OVERHEAD 11         // 8 bytes header + 2 bytes length + 1 byte checksum
+#define FP_RESPONSE_MIN_LENGTH 11    // 4 bytes password + 2 bytes cmd + 4 bytes error + 1 byte checksum
+
+// Largest application data length accepted by the frame decoder
+#ifndef FP_MAX_FRAME_DATA
+#if defined(__AVR__)
+#define FP_MAX_FRAME_DATA 80
+#else
+#define FP_MAX_FRAME_DATA 512
+#endif
+#endif
+
+struct FingerprintMatchResult {
+  bool matched;
+  uint16_t fingerprintId;
+  uint16_t matchScore;
+};
+
+struct FingerprintEnrollResult {
+  uint16_t fingerprintId;
+  uint8_t progress;
+  bool completed;
+};
+
+struct FingerprintStorageInfo {
+  uint16_t totalCount;
+  uint8_t storageMap[64];
+};
+
+uint8_t fpm383fChecksum(const uint8_t* data, uint16_t length);
+uint8_t fpm383fFrameChecksum(uint16_t dataLength);
+
+// Encodes a command frame. Returns the frame length, or 0 if out is too small.
+uint16_t fpm383fEncodeFrame(uint8_t* out, uint16_t outSize, uint32_t password, uint8_t cmd1, uint8_t cmd2,
+                            const uint8_t* data, uint16_t dataLen);
+
+// Typed response parsers. Return false if the payload is too short.
+bool fpm383fParseMatchResult(const uint8_t* data, uint16_t length, FingerprintMatchResult* result);
+bool fpm383fParseEnrollResult(const uint8_t* data, uint16_t length, FingerprintEnrollResult* result);
+bool fpm383fParseTemplateCount(const uint8_t* data, uint16_t length, uint16_t* count);
+bool fpm383fParseFlag(const uint8_t* data, uint16_t length, bool* flag);
+// Copies the non-zero characters of the 16-byte module ID; out is always NUL-terminated
+bool fpm383fParseModuleId(const uint8_t* data, uint16_t length, char* out, size_t outSize);
+
+// Incremental decoder for response frames. Bytes are pushed one at a time in
+// constant time (the checksum is accumulated as bytes arrive); memory use is
+// fixed and frames whose length field is out of range are rejected before any
+// payload is buffered.
+class FPM383FFrameDecoder {
+public:
+  enum Status {
+    NEED_MORE,
+    FRAME_READY,
+    FRAME_ERROR
+  };
+  
+  FPM383FFrameDecoder();
+  
+  void reset();
+  Status push(uint8_t byte);
+  
+  // Valid after FRAME_READY
+  uint8_t getCmd1() const;
+  uint8_t getCmd2() const;
+  uint32_t getErrorCode() const;
+  const uint8_t* getPayload() const;
+  uint16_t getPayloadLength() const;
+  uint16_t getFrameLength() const;
+  
+  // Valid after FRAME_ERROR (FP_ERROR_INVALID_DATA or FP_ERROR_INVALID_LENGTH)
+  uint32_t getDecodeError() const;
+  
+private:
+  enum State {
+    STATE_HEADER,
+    STATE_LENGTH_HIGH,
+    STATE_LENGTH_LOW,
+    STATE_FRAME_CHECKSUM,
+    STATE_BODY
+  };
+  
+  uint8_t state;
+  uint8_t headerIdx;
+  uint16_t dataLength;
+  uint16_t bodyIdx;
+  uint8_t bodySum;
+  uint32_t decodeError;
+  uint8_t buffer[FP_MAX_FRAME_DATA];
+};
+
+#endif
@@ -0,0 +1,350 @@
+#include "FPM383FRTOS.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+#define FP_RTOS_SHUTDOWN 0xFF
+
+FPM383FRTOS::FPM383FRTOS(FPM383F& driver, HardwareSerial& uart) : driver(driver), uart(uart) {
+  queue = nullptr;
+  taskHandle = nullptr;
+  lock = nullptr;
+  stopped = nullptr;
+  stopping = false;
+  for (uint8_t i = 0; i < FP_RTOS_QUEUE_LENGTH; i++) {
+    slots[i].state = SLOT_FREE;
+    slots[i].signal = nullptr;
+  }
+}
+
+FPM383FRTOS::~FPM383FRTOS() {
+  end();
+
+  // No task can be waiting on these once end() has returned and the object is gone
+  for (uint8_t i = 0; i < FP_RTOS_QUEUE_LENGTH; i++) {
+    if (slots[i].signal) vSemaphoreDelete(slots[i].signal);
+  }
+  if (stopped) vSemaphoreDelete(stopped);
+  if (lock) vSemaphoreDelete(lock);
+}
+
+bool FPM383FRTOS::createSync() {
+  // Created once and kept across end()/begin(): a caller may still be
+  // collecting its result after end()
+  if (!lock) lock = xSemaphoreCreateMutex();
+  if (!stopped) stopped = xSemaphoreCreateBinary();
+  if (!lock || !stopped) return false;
+
+  for (uint8_t i = 0; i < FP_RTOS_QUEUE_LENGTH; i++) {
+    if (!slots[i].signal) slots[i].signal = xSemaphoreCreateBinary();
+    if (!slots[i].signal) return false;
+  }
+  return true;
+}
+
+bool FPM383FRTOS::begin(uint32_t stackSize, UBaseType_t priority, BaseType_t core) {
+  if (taskHandle) return true;
+  if (!createSync()) return false;
+
+  // One entry per slot plus the shutdown message, so sends never block
+  queue = xQueueCreate(FP_RTOS_QUEUE_LENGTH + 1, sizeof(Message));
+  if (!queue) return false;
+
+  stopping = false;
+  if (xTaskCreatePinnedToCore(taskEntry, "fpm383f", stackSize, this, priority, &taskHandle, core) != pdPASS) {
+    vQueueDelete(queue);
+    queue = nullptr;
+    taskHandle = nullptr;
+    return false;
+  }
+
+  // Wake the driver task whenever the UART driver reports received bytes
+  uart.onReceive([this]() {
+    if (taskHandle) {
+      xTaskNotifyGive(taskHandle);
+    }
+  });
+
+  return true;
+}
+
+void FPM383FRTOS::end() {
+  if (!taskHandle) return;
+
+  // Queued behind every accepted request; no request is accepted after it
+  Message message;
+  message.slot = FP_RTOS_SHUTDOWN;
+  xSemaphoreTake(lock, portMAX_DELAY);
+  stopping = true;
+  xQueueSend(queue, &message, 0);
+  xSemaphoreGive(lock);
+
+  // The driver task completes the request in flight (bounded by its
+  // timeout), fails the queued ones with FP_ERROR_RTOS_STOPPED and exits
+  xSemaphoreTake(stopped, portMAX_DELAY);
+
+  uart.onReceive(nullptr);
+  taskHandle = nullptr;
+  vQueueDelete(queue);
+  queue = nullptr;
+}
+
+void FPM383FRTOS::taskEntry(void* arg) {
+  static_cast<FPM383FRTOS*>(arg)->run();
+}
+
+void FPM383FRTOS::run() {
+  Message message;
+
+  for (;;) {
+    // Blocked here with no CPU use while idle
+    if (xQueueReceive(queue, &message, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+    if (message.slot != FP_RTOS_SHUTDOWN) {
+      process(message);
+      continue;
+    }
+
+    // Every request queued before the shutdown message has been failed
+    xSemaphoreGive(stopped);
+    vTaskDelete(nullptr);
+  }
+}
+
+void FPM383FRTOS::process(Message& message) {
+  if (!startSlot(message.slot)) {
+    return;  // the caller gave up, or end() failed the request
+  }
+
+  FPM383FRTOSResult result;
+  result.completed = false;
+  result.dataLen = 0;
+
+  // Drop RX notifications left over from bytes received while idle
+  ulTaskNotifyTake(pdTRUE, 0);
+
+  uint8_t state = FP_REQUEST_FAILED;
+  if (driver.beginRequest(message.cmd1, message.cmd2, message.dataLen ? message.data : nullptr,
+                          message.dataLen, message.timeout)) {
+    TickType_t start = xTaskGetTickCount();
+    TickType_t limit = pdMS_TO_TICKS(message.timeout) + 1;
+
+    while ((state = driver.pollRequest()) == FP_REQUEST_PENDING) {
+      // Sleep until more bytes arrive; the wait is capped so the driver can report the timeout
+      TickType_t elapsed = xTaskGetTickCount() - start;
+      ulTaskNotifyTake(pdTRUE, elapsed < limit ? limit - elapsed : 1);
+    }
+  }
+
+  result.completed = (state == FP_REQUEST_DONE);
+  result.errorCode = result.completed ? driver.getResponseError() : driver.getLastError();
+  if (result.completed) {
+    result.dataLen = min(driver.getResponseLength(), (uint16_t)FP_RTOS_MAX_RESPONSE_DATA);
+    memcpy(result.data, driver.getResponseData(), result.dataLen);
+  }
+
+  finishSlot(message.slot, result);
+}
+
+bool FPM383FRTOS::startSlot(uint8_t slot) {
+  Slot& entry = slots[slot];
+  bool run;
+
+  xSemaphoreTake(lock, portMAX_DELAY);
+  run = entry.state == SLOT_QUEUED && !stopping;
+  if (run) {
+    entry.state = SLOT_RUNNING;
+    entry.startedAt = xTaskGetTickCount();
+  } else if (entry.state == SLOT_QUEUED) {
+    entry.result.completed = false;
+    entry.result.errorCode = FP_ERROR_RTOS_STOPPED;
+    entry.result.dataLen = 0;
+    entry.state = SLOT_DONE;
+  } else {
+    entry.state = SLOT_FREE;  // abandoned while queued
+  }
+  if (entry.state != SLOT_FREE) {
+    xSemaphoreGive(entry.signal);  // started: the caller restarts its wait with the request timeout
+  }
+  xSemaphoreGive(lock);
+  return run;
+}
+
+void FPM383FRTOS::finishSlot(uint8_t slot, const FPM383FRTOSResult& result) {
+  Slot& entry = slots[slot];
+
+  xSemaphoreTake(lock, portMAX_DELAY);
+  if (entry.state == SLOT_ABANDONED) {
+    entry.state = SLOT_FREE;
+  } else {
+    entry.result = result;
+    entry.state = SLOT_DONE;
+    xSemaphoreGive(entry.signal);
+  }
+  xSemaphoreGive(lock);
+}
+
+bool FPM383FRTOS::waitSlot(uint8_t slot, uint32_t timeout, FPM383FRTOSResult* result) {
+  Slot& entry = slots[slot];
+  TickType_t waitStart = xTaskGetTickCount();
+  TickType_t limit = pdMS_TO_TICKS(FP_RTOS_QUEUE_TIMEOUT);
+  bool started = false;
+
+  for (;;) {
+    TickType_t elapsed = xTaskGetTickCount() - waitStart;
+    xSemaphoreTake(entry.signal, elapsed < limit ? limit - elapsed : 0);
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (entry.state == SLOT_DONE) {
+      *result = entry.result;
+      entry.state = SLOT_FREE;
+      xSemaphoreGive(lock);
+      return result->completed;
+    }
+    if (entry.state == SLOT_RUNNING && !started) {
+      started = true;
+      waitStart = entry.startedAt;
+      limit = pdMS_TO_TICKS(timeout + FP_RTOS_WAIT_MARGIN);
+    } else if (xTaskGetTickCount() - waitStart >= limit) {
+      // The driver task frees the slot; result is left untouched
+      entry.state = SLOT_ABANDONED;
+      xSemaphoreGive(lock);
+      return false;
+    }
+    xSemaphoreGive(lock);
+  }
+}
+
+bool FPM383FRTOS::request(uint8_t cmd1, uint8_t cmd2, const uint8_t* data, uint16_t dataLen,
+                          FPM383FRTOSResult* result, uint32_t timeout) {
+  if (!lock || !result || dataLen > FP_RTOS_MAX_REQUEST_DATA) {
+    return false;
+  }
+
+  Message message;
+  message.cmd1 = cmd1;
+  message.cmd2 = cmd2;
+  message.dataLen = dataLen;
+  if (data && dataLen > 0) {
+    memcpy(message.data, data, dataLen);
+  }
+  message.timeout = timeout;
+
+  xSemaphoreTake(lock, portMAX_DELAY);
+  uint8_t slot = 0;
+  while (slot < FP_RTOS_QUEUE_LENGTH && slots[slot].state != SLOT_FREE) {
+    slot++;
+  }
+  if (!queue || stopping || slot == FP_RTOS_QUEUE_LENGTH) {
+    xSemaphoreGive(lock);
+    return false;
+  }
+
+  // Drop a signal left by a request that finished as its caller timed out
+  xSemaphoreTake(slots[slot].signal, 0);
+  slots[slot].state = SLOT_QUEUED;
+  message.slot = slot;
+  xQueueSend(queue, &message, 0);  // sized so it never blocks
+  xSemaphoreGive(lock);
+
+  return waitSlot(slot, timeout, result);
+}
+
+bool FPM383FRTOS::requestStatus(uint8_t cmd1, uint8_t cmd2, const uint8_t* data, uint16_t dataLen) {
+  FPM383FRTOSResult result;
+
+  if (!request(cmd1, cmd2, data, dataLen, &result)) {
+    return false;
+  }
+
+  return result.errorCode == FP_ERROR_SUCCESS;
+}
+
+bool FPM383FRTOS::heartbeat() {
+  return requestStatus(FP_CMD_MAINTENANCE_0, FP_CMD_HEARTBEAT, nullptr, 0);
+}
+
+FingerprintMatchResult FPM383FRTOS::matchSync() {
+  FingerprintMatchResult match = {false, 0, 0};
+  FPM383FRTOSResult result;
+
+  if (request(FP_CMD_FINGERPRINT_0, FP_CMD_MATCH_SYNC, nullptr, 0, &result) && result.errorCode == FP_ERROR_SUCCESS) {
+    fpm383fParseMatchResult(result.data, result.dataLen, &match);
+  }
+
+  return match;
+}
+
+bool FPM383FRTOS::startMatch() {
+  return requestStatus(FP_CMD_FINGERPRINT_0, FP_CMD_MATCH, nullptr, 0);
+}
+
+FingerprintMatchResult FPM383FRTOS::queryMatchResult() {
+  FingerprintMatchResult match = {false, 0, 0};
+  FPM383FRTOSResult result;
+
+  if (request(FP_CMD_FINGERPRINT_0, FP_CMD_QUERY_MATCH, nullptr, 0, &result) && result.errorCode == FP_ERROR_SUCCESS) {
+    fpm383fParseMatchResult(result.data, result.dataLen, &match);
+  }
+
+  return match;
+}
+
+bool FPM383FRTOS::startEnrollment(uint8_t regIndex) {
+  uint8_t data[1];
+  data[0] = regIndex;
+
+  return requestStatus(FP_CMD_FINGERPRINT_0, FP_CMD_ENROLL, data, 1);
+}
+
+FingerprintEnrollResult FPM383FRTOS::queryEnrollmentResult() {
+  FingerprintEnrollResult enroll = {0, 0, false};
+  FPM383FRTOSResult result;
+
+  if (request(FP_CMD_FINGERPRINT_0, FP_CMD_QUERY_ENROLL, nullptr, 0, &result) && result.errorCode == FP_ERROR_SUCCESS) {
+    fpm383fParseEnrollResult(result.data, result.dataLen, &enroll);
+  }
+
+  return enroll;
+}
+
+bool FPM383FRTOS::saveTemplate(uint16_t fingerprintId) {
+  uint8_t data[2];
+  data[0] = (fingerprintId >> 8) & 0xFF;
+  data[1] = fingerprintId & 0xFF;
+
+  return requestStatus(FP_CMD_FINGERPRINT_0, FP_CMD_SAVE_TEMPLATE, data, 2);
+}
+
+bool FPM383FRTOS::deleteFingerprint(uint16_t fingerprintId) {
+  uint8_t data[3];
+  data[0] = 0x00; // Single fingerprint delete mode
+  data[1] = (fingerprintId >> 8) & 0xFF;
+  data[2] = fingerprintId & 0xFF;
+
+  return requestStatus(FP_CMD_FINGERPRINT_0, FP_CMD_DELETE, data, 3);
+}
+
+uint16_t FPM383FRTOS::getTemplateCount() {
+  uint16_t count = 0;
+  FPM383FRTOSResult result;
+
+  if (request(FP_CMD_SYSTEM_0, FP_CMD_GET_TEMPLATE_COUNT, nullptr, 0, &result) && result.errorCode == FP_ERROR_SUCCESS) {
+    fpm383fParseTemplateCount(result.data, result.dataLen, &count);
+  }
+
+  return count;
+}
+
+bool FPM383FRTOS::setLED(uint8_t mode, uint8_t color, uint8_t param1, uint8_t param2, uint8_t param3) {
+  uint8_t data[5];
+  data[0] = mode;
+  data[1] = color;
+  data[2] = param1;
+  data[3] = param2;
+  data[4] = param3;
+
+  return requestStatus(FP_CMD_SYSTEM_0, FP_CMD_SET_LED, data, 5);
+}
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef FPM383F_RTOS_H
+#define FPM383F_RTOS_H
+
+// FreeRTOS integration for ESP32. A dedicated driver task owns the UART and
+// the FPM383F instance; other tasks submit requests through a queue and block
+// (without using CPU) on a semaphore of the request's slot until the driver
+// task has filled in the result. The driver task sleeps on the queue while
+// idle and on UART RX events while a response is pending.
+//
+// Waits are bounded: FP_RTOS_QUEUE_TIMEOUT until the driver task starts the
+// request, then the request timeout plus FP_RTOS_WAIT_MARGIN. A caller that
+// gives up leaves its slot to the driver task, which skips or discards the
+// request, so results are never written after request() has returned.
+//
+//   HardwareSerial fpSerial(1);
+//   FPM383F fingerprint(fpSerial);
+//   FPM383FRTOS fpTask(fingerprint, fpSerial);
+//
+//   void setup() {
+//     fpSerial.begin(57600, SERIAL_8N1, RX_PIN, TX_PIN);
+//     fpTask.begin();
+//   }
+//
+//   // From any task:
+//   FingerprintMatchResult result = fpTask.matchSync();
+//
+// Once begin() has been called, the FPM383F instance must only be used
+// through this class.
+
+#include "FPM383F.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+
+#define FP_ERROR_RTOS_STOPPED 0x00010001  // end() was called before the request ran
+
+#ifndef FP_RTOS_QUEUE_LENGTH
+#define FP_RTOS_QUEUE_LENGTH 8
+#endif
+#ifndef FP_RTOS_QUEUE_TIMEOUT
+#define FP_RTOS_QUEUE_TIMEOUT 30000   // wait for the driver task to start a request (ms)
+#endif
+#ifndef FP_RTOS_WAIT_MARGIN
+#define FP_RTOS_WAIT_MARGIN 500       // added to the request timeout once it has started (ms)
+#endif
+#ifndef FP_RTOS_MAX_REQUEST_DATA
+#define FP_RTOS_MAX_REQUEST_DATA 16
+#endif
+#ifndef FP_RTOS_MAX_RESPONSE_DATA
+#define FP_RTOS_MAX_RESPONSE_DATA 32
+#endif
+
+struct FPM383FRTOSResult {
+  bool completed;               // response frame received and matched the request
+  uint32_t errorCode;           // module error code, or transport error if not completed
+  uint16_t dataLen;
+  uint8_t data[FP_RTOS_MAX_RESPONSE_DATA];
+};
+
+class FPM383FRTOS {
+public:
+  FPM383FRTOS(FPM383F& driver, HardwareSerial& uart);
+  ~FPM383FRTOS();
+
+  bool begin(uint32_t stackSize = 4096, UBaseType_t priority = 5, BaseType_t core = tskNO_AFFINITY);
+  void end();  // fails queued requests with FP_ERROR_RTOS_STOPPED once the current one completes
+
+  // Thread-safe. Blocks the calling task until the driver task has completed the
+  // request; returns false without touching result if the wait times out.
+  bool request(uint8_t cmd1, uint8_t cmd2, const uint8_t* data, uint16_t dataLen,
+               FPM383FRTOSResult* result, uint32_t timeout = FP_RESPONSE_TIMEOUT);
+
+  // Typed helpers
+  bool heartbeat();
+  FingerprintMatchResult matchSync();
+  bool startMatch();
+  FingerprintMatchResult queryMatchResult();
+  bool startEnrollment(uint8_t regIndex);
+  FingerprintEnrollResult queryEnrollmentResult();
+  bool saveTemplate(uint16_t fingerprintId);
+  bool deleteFingerprint(uint16_t fingerprintId);
+  uint16_t getTemplateCount();
+  bool setLED(uint8_t mode, uint8_t color, uint8_t param1 = 0, uint8_t param2 = 0, uint8_t param3 = 0);
+
+private:
+  enum SlotState {
+    SLOT_FREE,
+    SLOT_QUEUED,
+    SLOT_RUNNING,
+    SLOT_DONE,        // result ready for the caller
+    SLOT_ABANDONED    // caller timed out; the driver task frees the slot
+  };
+
+  // Owned by this object rather than the caller's stack, so a late result
+  // cannot land in memory the caller has already released
+  struct Slot {
+    SlotState state;
+    TickType_t startedAt;
+    SemaphoreHandle_t signal;   // given when the request starts and when it is done
+    FPM383FRTOSResult result;
+  };
+
+  struct Message {
+    uint8_t cmd1;
+    uint8_t cmd2;
+    uint8_t data[FP_RTOS_MAX_REQUEST_DATA];
+    uint16_t dataLen;
+    uint32_t timeout;
+    uint8_t slot;               // FP_RTOS_SHUTDOWN stops the driver task
+  };
+
+  FPM383F& driver;
+  HardwareSerial& uart;
+  QueueHandle_t queue;
+  TaskHandle_t taskHandle;
+  SemaphoreHandle_t lock;       // guards slots, stopping and sends to the queue
+  SemaphoreHandle_t stopped;    // given by the driver task right before it exits
+  bool stopping;
+  Slot slots[FP_RTOS_QUEUE_LENGTH];
+
+  bool createSync();
+  static void taskEntry(void* arg);
+  void run();
+  void process(Message& message);
+  bool startSlot(uint8_t slot);
+  void finishSlot(uint8_t slot, const FPM383FRTOSResult& result);
+  bool waitSlot(uint8_t slot, uint32_t timeout, FPM383FRTOSResult* result);
+  bool requestStatus(uint8_t cmd1, uint8_t cmd2, const uint8_t* data, uint16_t dataLen);
+};
+
+#endif
+
+#endif
@@ -0,0 +1,286 @@
+#include "FPM383FScanner.h"
+#include "FPM383FScoreTracker.h"
+
+FPM383FScanner::FPM383FScanner(FPM383F& driver, uint32_t duplicateWindow) : driver(driver) {
+  this->duplicateWindow = duplicateWindow;
+  pollInterval = FP_SCAN_POLL_INTERVAL;
+  phase = PHASE_STOPPED;
+  armedAt = 0;
+  runningSince = 0;
+  result.matched = false;
+  result.matchScore = 0;
+  result.fingerprintId = 0;
+  lastError = FP_ERROR_SUCCESS;
+  recentCount = 0;
+  resetStats();
+}
+
+bool FPM383FScanner::start() {
+  if (phase != PHASE_STOPPED) {
+    return true;
+  }
+
+  uint32_t now = driver.getClock().now();
+  runningSince = now;
+  recentCount = 0;
+  if (driver.isRequestPending()) {
+    // Arm from update() once the other request completes
+    phase = PHASE_BACKOFF;
+    deadline = FPM383FDeadline(now, 0);
+    return true;
+  }
+  if (!arm(now)) {
+    // Keep running; update() re-arms after the retry interval
+    lastError = driver.getLastError();
+    return false;
+  }
+  return true;
+}
+
+void FPM383FScanner::stop() {
+  if (phase == PHASE_STOPPED) {
+    return;
+  }
+
+  uint32_t now = driver.getClock().now();
+  stats.runningMs += now - runningSince;
+  bool ownRequest = phase == PHASE_ARMING || phase == PHASE_QUERYING;
+  phase = PHASE_STOPPED;
+
+  if (ownRequest) {
+    while (driver.pollRequest() == FP_REQUEST_PENDING) {
+      driver.getClock().sleep(0);
+    }
+  }
+
+  // A request another component started (e.g. an LED frame) is left for that
+  // component to complete; the module's match then ends at its own timeout
+  if (!driver.isRequestPending()) {
+    driver.cancelOperation();
+  }
+}
+
+bool FPM383FScanner::isRunning() {
+  return phase != PHASE_STOPPED;
+}
+
+void FPM383FScanner::setDuplicateWindow(uint32_t ms) {
+  duplicateWindow = ms;
+}
+
+void FPM383FScanner::setPollInterval(uint32_t ms) {
+  pollInterval = ms;
+}
+
+uint8_t FPM383FScanner::update() {
+  uint32_t now = driver.getClock().now();
+  uint8_t status;
+
+  switch (phase) {
+    case PHASE_STOPPED:
+      return FP_SCAN_NONE;
+
+    case PHASE_WAITING:
+      // Another request (e.g. an LED frame) owns the link until it completes
+      if (deadline.expired(now) && !driver.isRequestPending()) {
+        if (driver.beginRequest(FP_CMD_FINGERPRINT_0, FP_CMD_QUERY_MATCH)) {
+          phase = PHASE_QUERYING;
+        } else {
+          return fail(now, driver.getLastError());
+        }
+      }
+      return FP_SCAN_NONE;
+
+    case PHASE_BACKOFF:
+      if (deadline.expired(now) && !driver.isRequestPending() && !arm(now)) {
+        return fail(now, driver.getLastError());
+      }
+      return FP_SCAN_NONE;
+
+    case PHASE_ARMING:
+      status = driver.pollRequest();
+      if (status == FP_REQUEST_PENDING) {
+        return FP_SCAN_NONE;
+      }
+      if (status != FP_REQUEST_DONE) {
+        return fail(now, driver.getLastError());
+      }
+      if (driver.getResponseError() != FP_ERROR_SUCCESS) {
+        return fail(now, driver.getResponseError());
+      }
+      phase = PHASE_WAITING;
+      deadline = FPM383FDeadline(now, pollInterval);
+      return FP_SCAN_NONE;
+
+    case PHASE_QUERYING:
+      status = driver.pollRequest();
+      if (status == FP_REQUEST_PENDING) {
+        return FP_SCAN_NONE;
+      }
+      if (status != FP_REQUEST_DONE) {
+        return fail(now, driver.getLastError());
+      }
+      return handleResult(now);
+  }
+
+  return FP_SCAN_NONE;
+}
+
+const FingerprintMatchResult& FPM383FScanner::getResult() {
+  return result;
+}
+
+uint32_t FPM383FScanner::getLastError() {
+  return lastError;
+}
+
+const FPM383FScanStats& FPM383FScanner::getStats() {
+  if (phase != PHASE_STOPPED) {
+    uint32_t now = driver.getClock().now();
+    stats.runningMs += now - runningSince;
+    runningSince = now;
+  }
+  return stats;
+}
+
+uint32_t FPM383FScanner::getMatchesPerMinute() {
+  uint32_t running = getStats().runningMs;
+  if (running == 0) return 0;
+  return (uint32_t)(((uint64_t)stats.matches * 60000) / running);
+}
+
+uint32_t FPM383FScanner::getRecentMatchesPerMinute() {
+  if (matchTimeCount == 0) return 0;
+
+  // Until the ring is full every held match happened in the time run since
+  // resetStats(). After that the oldest held match opens the window and the
+  // matches after it are counted, so a short window is never taken as a minute.
+  uint32_t count, covered;
+  if (matchTimeCount < FP_SCAN_RATE_SAMPLES) {
+    count = matchTimeCount;
+    covered = getStats().runningMs;
+  } else {
+    count = FP_SCAN_RATE_SAMPLES - 1;
+    covered = driver.getClock().now() - matchTimes[matchTimeIndex];
+  }
+  if (covered == 0) return 0;
+  return (uint32_t)(((uint64_t)count * 60000) / covered);
+}
+
+void FPM383FScanner::resetStats() {
+  memset(&stats, 0, sizeof(FPM383FScanStats));
+  matchTimeIndex = 0;
+  matchTimeCount = 0;
+  runningSince = driver.getClock().now();
+}
+
+bool FPM383FScanner::arm(uint32_t now) {
+  if (!driver.beginRequest(FP_CMD_FINGERPRINT_0, FP_CMD_MATCH)) {
+    phase = PHASE_BACKOFF;
+    deadline = FPM383FDeadline(now, FP_SCAN_RETRY_INTERVAL);
+    return false;
+  }
+
+  phase = PHASE_ARMING;
+  armedAt = now;
+  return true;
+}
+
+uint8_t FPM383FScanner::fail(uint32_t now, uint32_t error) {
+  lastError = error;
+  stats.errors++;
+  phase = PHASE_BACKOFF;
+  deadline = FPM383FDeadline(now, FP_SCAN_RETRY_INTERVAL);
+  return FP_SCAN_ERROR;
+}
+
+uint8_t FPM383FScanner::handleResult(uint32_t now) {
+  uint32_t error = driver.getResponseError();
+
+  // Still capturing or matching
+  if (error == FP_ERROR_SYSTEM_BUSY) {
+    phase = PHASE_WAITING;
+    deadline = FPM383FDeadline(now, pollInterval);
+    return FP_SCAN_NONE;
+  }
+
+  FingerprintMatchResult parsed = {false, 0, 0};
+  bool valid = error == FP_ERROR_SUCCESS &&
+               fpm383fParseMatchResult(driver.getResponseData(), driver.getResponseLength(), &parsed);
+
+  stats.scans++;
+  stats.totalCycleMs += now - armedAt;
+
+  // Report with the link idle; update() re-arms from PHASE_BACKOFF as soon
+  // as no other request holds the link
+  phase = PHASE_BACKOFF;
+  deadline = FPM383FDeadline(now, 0);
+
+  if (error == FP_ERROR_TIMEOUT) {
+    // Nobody touched the sensor within the module's match timeout
+    stats.idleRearms++;
+    return FP_SCAN_NONE;
+  }
+
+  if (error != FP_ERROR_SUCCESS || !valid) {
+    lastError = error != FP_ERROR_SUCCESS ? error : FP_ERROR_INVALID_LENGTH;
+    stats.errors++;
+    return FP_SCAN_ERROR;
+  }
+
+  lastError = FP_ERROR_SUCCESS;
+
+  if (!parsed.matched) {
+    if (isDuplicate(FP_SCAN_UNKNOWN_ID, now)) {
+      stats.duplicates++;
+      return FP_SCAN_NONE;
+    }
+    stats.noMatches++;
+    result = parsed;
+    return FP_SCAN_NO_MATCH;
+  }
+
+  if (isDuplicate(parsed.fingerprintId, now)) {
+    stats.duplicates++;
+    return FP_SCAN_NONE;
+  }
+
+  // Only reported matches are scored. No-matches are not held for the next
+  // match: in a queue that is usually a different person.
+  if (driver.getScoreTracker()) {
+    driver.getScoreTracker()->recordMatch(parsed.fingerprintId, parsed.matchScore);
+  }
+
+  stats.matches++;
+  recordMatch(now);
+  result = parsed;
+  return FP_SCAN_MATCH;
+}
+
+bool FPM383FScanner::isDuplicate(uint16_t fingerprintId, uint32_t now) {
+  uint8_t oldest = 0;
+
+  for (uint8_t i = 0; i < recentCount; i++) {
+    if (recent[i].id == fingerprintId) {
+      bool duplicate = now - recent[i].time < duplicateWindow;
+      recent[i].time = now;
+      return duplicate;
+    }
+    if (now - recent[i].time > now - recent[oldest].time) {
+      oldest = i;
+    }
+  }
+
+  uint8_t slot = recentCount < FP_SCAN_RECENT_IDS ? recentCount++ : oldest;
+  recent[slot].id = fingerprintId;
+  recent[slot].time = now;
+  return false;
+}
+
+void FPM383FScanner::recordMatch(uint32_t now) {
+  matchTimes[matchTimeIndex] = now;
+  matchTimeIndex = (matchTimeIndex + 1) % FP_SCAN_RATE_SAMPLES;
+  if (matchTimeCount < FP_SCAN_RATE_SAMPLES) {
+    matchTimeCount++;
+  }
+}
@@ -0,0 +1,115 @@
+#ifndef FPM383F_SCANNER_H
+#define FPM383F_SCANNER_H
+
+// Continuous identification for turnstiles and other queues. The scanner
+// keeps the module matching at all times:
+//
+//   - a result is reported with the link idle, so the application can start
+//     an LED frame or other request while handling it; START_MATCH is re-sent
+//     from the next update() once the link is free again
+//   - while a match is in progress QUERY_MATCH is polled every pollInterval;
+//     between polls the link is idle, so FPM383FLed and FPM383FHealth can run
+//   - a fingerprint ID already reported within the duplicate window is
+//     suppressed (a finger left on the sensor keeps extending the window);
+//     unknown fingers are tracked as one more ID, so an unenrolled finger left
+//     on the sensor is reported once rather than on every re-arm
+//
+// All requests go through the non-blocking API; do not call blocking driver
+// functions while the scanner is running.
+//
+//   FPM383FScanner scanner(fingerprint);
+//   scanner.start();
+//   ...
+//   if (scanner.update() == FP_SCAN_MATCH) {
+//     openGate(scanner.getResult().fingerprintId);
+//   }
+
+#include "FPM383F.h"
+
+// update() events
+#define FP_SCAN_NONE 0
+#define FP_SCAN_MATCH 1       // new (non-duplicate) match, see getResult()
+#define FP_SCAN_NO_MATCH 2    // finger scanned but not enrolled
+#define FP_SCAN_ERROR 3       // module or link error, see getLastError()
+
+#ifndef FP_SCAN_DUPLICATE_WINDOW
+#define FP_SCAN_DUPLICATE_WINDOW 3000
+#endif
+#ifndef FP_SCAN_POLL_INTERVAL
+#define FP_SCAN_POLL_INTERVAL 20
+#endif
+#define FP_SCAN_RETRY_INTERVAL 200   // wait before re-arming after an error
+#define FP_SCAN_RECENT_IDS 4         // IDs tracked for duplicate suppression
+#define FP_SCAN_UNKNOWN_ID 0xFFFF    // duplicate-suppression key for no-match results
+#define FP_SCAN_RATE_SAMPLES 8       // matches used for the recent rate
+
+struct FPM383FScanStats {
+  uint32_t scans;         // match results read from the module
+  uint32_t matches;       // reported matches
+  uint32_t noMatches;     // reported no-matches
+  uint32_t duplicates;    // suppressed repeat matches and no-matches
+  uint32_t idleRearms;    // module match timeouts with no finger
+  uint32_t errors;        // reported FP_SCAN_ERROR events
+  uint32_t totalCycleMs;  // arm-to-result time of all scans
+  uint32_t runningMs;
+};
+
+class FPM383FScanner {
+public:
+  FPM383FScanner(FPM383F& driver, uint32_t duplicateWindow = FP_SCAN_DUPLICATE_WINDOW);
+
+  bool start();
+  void stop();   // waits for the scanner's own request and cancels the module's match
+  bool isRunning();
+
+  void setDuplicateWindow(uint32_t ms);
+  void setPollInterval(uint32_t ms);
+
+  uint8_t update();
+
+  const FingerprintMatchResult& getResult();
+  uint32_t getLastError();
+  const FPM383FScanStats& getStats();
+  uint32_t getMatchesPerMinute();        // sustained rate while running
+  uint32_t getRecentMatchesPerMinute();  // over the last FP_SCAN_RATE_SAMPLES matches
+  void resetStats();
+
+private:
+  enum Phase {
+    PHASE_STOPPED,
+    PHASE_ARMING,     // START_MATCH pending
+    PHASE_WAITING,    // match in progress, waiting to poll
+    PHASE_QUERYING,   // QUERY_MATCH pending
+    PHASE_BACKOFF     // waiting to re-arm after a result or an error
+  };
+
+  struct RecentId {
+    uint16_t id;
+    uint32_t time;
+  };
+
+  FPM383F& driver;
+  uint32_t duplicateWindow;
+  uint32_t pollInterval;
+  Phase phase;
+  FPM383FDeadline deadline;
+  uint32_t armedAt;
+  uint32_t runningSince;
+  FingerprintMatchResult result;
+  uint32_t lastError;
+  FPM383FScanStats stats;
+
+  RecentId recent[FP_SCAN_RECENT_IDS];
+  uint8_t recentCount;
+  uint32_t matchTimes[FP_SCAN_RATE_SAMPLES];
+  uint8_t matchTimeIndex;
+  uint8_t matchTimeCount;
+
+  bool arm(uint32_t now);
+  uint8_t fail(uint32_t now, uint32_t error);
+  uint8_t handleResult(uint32_t now);
+  bool isDuplicate(uint16_t fingerprintId, uint32_t now);
+  void recordMatch(uint32_t now);
+};
+
+#endif
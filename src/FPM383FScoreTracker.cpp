@@ -0,0 +1,205 @@
+#include "FPM383FScoreTracker.h"
+#include <math.h>
+
+FPM383FScoreTracker::FPM383FScoreTracker(FPM383F& driver) : driver(driver) {
+  clear();
+}
+
+void FPM383FScoreTracker::record(const FingerprintMatchResult& result) {
+  if (result.matched) {
+    recordMatch(result.fingerprintId, result.matchScore);
+  } else {
+    recordReject();
+  }
+}
+
+void FPM383FScoreTracker::recordMatch(uint16_t fingerprintId, uint16_t score) {
+  uint32_t now = driver.getClock().now();
+  FPM383FTemplateScore* entry = findOrAdd(fingerprintId, now);
+
+  // A no-match shortly before this match was most likely this user's first try
+  if (pendingRejects > 0) {
+    if (now - pendingSince < FP_SCORE_RETRY_WINDOW) {
+      entry->rejects += pendingRejects;
+    }
+    pendingRejects = 0;
+  }
+
+  entry->matches++;
+  entry->lastMatchTime = now;
+
+  if (entry->samples < FP_SCORE_MIN_SAMPLES || entry->meanScore - score <= 2 * dropThreshold(*entry)) {
+    entry->samples++;
+    float delta = score - entry->meanScore;
+    entry->meanScore += delta / entry->samples;
+    entry->m2 += delta * (score - entry->meanScore);
+  }
+
+  if (entry->matches == 1) {
+    entry->recentScore = score;
+  } else {
+    entry->recentScore += (score - entry->recentScore) / FP_SCORE_RECENT_WEIGHT;
+  }
+}
+
+void FPM383FScoreTracker::recordReject() {
+  uint32_t now = driver.getClock().now();
+
+  if (pendingRejects == 0 || now - pendingSince >= FP_SCORE_RETRY_WINDOW) {
+    pendingRejects = 0;
+    pendingSince = now;
+  }
+  pendingRejects++;
+}
+
+void FPM383FScoreTracker::recordReject(uint16_t fingerprintId) {
+  uint32_t now = driver.getClock().now();
+  FPM383FTemplateScore* entry = findOrAdd(fingerprintId, now);
+  entry->rejects++;
+  entry->lastRejectTime = now;
+}
+
+bool FPM383FScoreTracker::getScore(uint16_t fingerprintId, FPM383FTemplateScore& score) {
+  FPM383FTemplateScore* entry = find(fingerprintId);
+  if (!entry) return false;
+
+  score = *entry;
+  return true;
+}
+
+uint8_t FPM383FScoreTracker::getCount() {
+  return count;
+}
+
+const FPM383FTemplateScore& FPM383FScoreTracker::getEntry(uint8_t index) {
+  return entries[index < count ? index : 0];
+}
+
+float FPM383FScoreTracker::getStdDev(const FPM383FTemplateScore& score) {
+  if (score.samples < 2) return 0;
+  return sqrt(score.m2 / (score.samples - 1));
+}
+
+bool FPM383FScoreTracker::isDegrading(const FPM383FTemplateScore& score) {
+  uint16_t attempts = score.matches + score.rejects;
+  if (attempts < FP_SCORE_MIN_SAMPLES) return false;
+
+  if ((uint32_t)score.rejects * 100 >= (uint32_t)attempts * FP_SCORE_REJECT_PERCENT) {
+    return true;
+  }
+
+  if (score.samples < FP_SCORE_MIN_SAMPLES) return false;
+  return score.meanScore - score.recentScore > dropThreshold(score);
+}
+
+// A drop must exceed the template's usual spread and a meaningful share of
+// its mean
+float FPM383FScoreTracker::dropThreshold(const FPM383FTemplateScore& score) {
+  float minDrop = score.meanScore * FP_SCORE_DROP_PERCENT / 100;
+  float stdDev = getStdDev(score);
+  return stdDev > minDrop ? stdDev : minDrop;
+}
+
+uint8_t FPM383FScoreTracker::findDegrading(uint16_t* ids, uint8_t maxIds) {
+  float severities[FP_SCORE_MAX_TEMPLATES];
+  uint8_t found = 0;
+
+  if (maxIds > FP_SCORE_MAX_TEMPLATES) {
+    maxIds = FP_SCORE_MAX_TEMPLATES;
+  }
+
+  for (uint8_t i = 0; i < count; i++) {
+    if (!isDegrading(entries[i])) continue;
+
+    // Insertion sort, worst first
+    float value = severity(entries[i]);
+    uint8_t pos = found < maxIds ? found : maxIds;
+    while (pos > 0 && severities[pos - 1] < value) {
+      if (pos < maxIds) {
+        ids[pos] = ids[pos - 1];
+        severities[pos] = severities[pos - 1];
+      }
+      pos--;
+    }
+    if (pos < maxIds) {
+      ids[pos] = entries[i].fingerprintId;
+      severities[pos] = value;
+      if (found < maxIds) found++;
+    }
+  }
+
+  return found;
+}
+
+void FPM383FScoreTracker::forget(uint16_t fingerprintId) {
+  FPM383FTemplateScore* entry = find(fingerprintId);
+  if (!entry) return;
+
+  *entry = entries[count - 1];
+  count--;
+}
+
+void FPM383FScoreTracker::clear() {
+  memset(entries, 0, sizeof(entries));
+  count = 0;
+  pendingRejects = 0;
+  pendingSince = 0;
+}
+
+void FPM383FScoreTracker::printReport(Print& output) {
+  output.println("FPM383F template scores:");
+  for (uint8_t i = 0; i < count; i++) {
+    const FPM383FTemplateScore& score = entries[i];
+    output.println("  id=" + String(score.fingerprintId) + " matches=" + String(score.matches) +
+                   " rejects=" + String(score.rejects) + " mean=" + String(score.meanScore, 1) +
+                   " sd=" + String(getStdDev(score), 1) + " recent=" + String(score.recentScore, 1) +
+                   (isDegrading(score) ? " DEGRADING" : ""));
+  }
+}
+
+FPM383FTemplateScore* FPM383FScoreTracker::find(uint16_t fingerprintId) {
+  for (uint8_t i = 0; i < count; i++) {
+    if (entries[i].fingerprintId == fingerprintId) {
+      return &entries[i];
+    }
+  }
+  return nullptr;
+}
+
+FPM383FTemplateScore* FPM383FScoreTracker::findOrAdd(uint16_t fingerprintId, uint32_t now) {
+  FPM383FTemplateScore* entry = find(fingerprintId);
+  if (entry) return entry;
+
+  if (count < FP_SCORE_MAX_TEMPLATES) {
+    entry = &entries[count++];
+  } else {
+    entry = &entries[0];
+    for (uint8_t i = 1; i < count; i++) {
+      if (evictionAge(entries[i], now) > evictionAge(*entry, now)) {
+        entry = &entries[i];
+      }
+    }
+  }
+
+  // Match and reject times are set by the caller that created the entry
+  memset(entry, 0, sizeof(FPM383FTemplateScore));
+  entry->fingerprintId = fingerprintId;
+  return entry;
+}
+
+// Only accepted matches keep a template in the table. Templates that never
+// matched go first, longest unrejected first; the top bit keeps them above
+// every matched template.
+uint32_t FPM383FScoreTracker::evictionAge(const FPM383FTemplateScore& score, uint32_t now) {
+  if (score.matches == 0) {
+    return 0x80000000UL | ((now - score.lastRejectTime) >> 1);
+  }
+  return (now - score.lastMatchTime) >> 1;
+}
+
+float FPM383FScoreTracker::severity(const FPM383FTemplateScore& score) {
+  uint16_t attempts = score.matches + score.rejects;
+  float rejectRate = attempts ? (float)score.rejects / attempts : 0;
+  float drop = score.meanScore > 0 ? (score.meanScore - score.recentScore) / score.meanScore : 0;
+  return rejectRate + (drop > 0 ? drop : 0);
+}
@@ -0,0 +1,92 @@
+#ifndef FPM383F_SCORE_TRACKER_H
+#define FPM383F_SCORE_TRACKER_H
+
+// Per-template match-score statistics in a fixed-size table. Attach it to the
+// driver with setScoreTracker() and every matchSync(), queryMatchResult(),
+// verify() and FPM383FScanner result is recorded:
+//
+//   - matches update a short-term average of the last few scores and the
+//     template's baseline mean/variance (Welford); scores far below the
+//     baseline are left out of it, so a degrading template keeps being
+//     compared with its healthy history until it is re-enrolled
+//   - a verify() reject counts against the claimed ID; a 1:N no-match is
+//     held for FP_SCORE_RETRY_WINDOW and counted against the template that
+//     matches next, since a quick successful retry means the first attempt
+//     was a false reject
+//   - FPM383FScanner records only the matches it reports; its no-matches are
+//     not held, since in a queue the next match is usually someone else
+//
+// findDegrading() lists templates whose recent scores dropped well below
+// their own history or that are often rejected, so updateFeature() or
+// re-enrollment can be scheduled before users notice. When the table is
+// full a template that was only ever rejected is evicted first (the longest
+// unrejected), then the least recently matched one; rejects never refresh a
+// template's match recency.
+
+#include "FPM383F.h"
+
+#ifndef FP_SCORE_MAX_TEMPLATES
+#if defined(__AVR__)
+#define FP_SCORE_MAX_TEMPLATES 8
+#else
+#define FP_SCORE_MAX_TEMPLATES 64
+#endif
+#endif
+#ifndef FP_SCORE_RETRY_WINDOW
+#define FP_SCORE_RETRY_WINDOW 10000
+#endif
+#define FP_SCORE_RECENT_WEIGHT 8       // short-term average over roughly the last 8 scores
+#define FP_SCORE_MIN_SAMPLES 5         // attempts needed before a template can be flagged
+#define FP_SCORE_DROP_PERCENT 10       // minimum drop of the recent score below the mean
+#define FP_SCORE_REJECT_PERCENT 25     // reject rate that flags a template
+
+struct FPM383FTemplateScore {
+  uint16_t fingerprintId;
+  uint16_t matches;
+  uint16_t rejects;
+  uint32_t lastMatchTime;  // driver clock, accepted matches only; orders eviction
+  uint32_t lastRejectTime; // driver clock, 1:1 rejects of this ID
+  uint16_t samples;        // scores in the baseline
+  float meanScore;         // baseline
+  float m2;                // sum of squared deviations from the baseline mean
+  float recentScore;
+};
+
+class FPM383FScoreTracker {
+public:
+  FPM383FScoreTracker(FPM383F& driver);
+
+  // Called by the driver when attached; can also be fed directly
+  void record(const FingerprintMatchResult& result);
+  void recordMatch(uint16_t fingerprintId, uint16_t score);
+  void recordReject();                        // 1:N no-match
+  void recordReject(uint16_t fingerprintId);  // 1:1 reject of a claimed ID
+
+  bool getScore(uint16_t fingerprintId, FPM383FTemplateScore& score);
+  uint8_t getCount();
+  const FPM383FTemplateScore& getEntry(uint8_t index);
+  static float getStdDev(const FPM383FTemplateScore& score);
+
+  // Fills ids with degrading templates, worst first; returns how many
+  uint8_t findDegrading(uint16_t* ids, uint8_t maxIds);
+  bool isDegrading(const FPM383FTemplateScore& score);
+
+  void forget(uint16_t fingerprintId);  // after updateFeature() or re-enrollment
+  void clear();
+  void printReport(Print& output);
+
+private:
+  FPM383F& driver;
+  FPM383FTemplateScore entries[FP_SCORE_MAX_TEMPLATES];
+  uint8_t count;
+  uint16_t pendingRejects;
+  uint32_t pendingSince;
+
+  FPM383FTemplateScore* find(uint16_t fingerprintId);
+  FPM383FTemplateScore* findOrAdd(uint16_t fingerprintId, uint32_t now);
+  static uint32_t evictionAge(const FPM383FTemplateScore& score, uint32_t now);
+  float severity(const FPM383FTemplateScore& score);
+  static float dropThreshold(const FPM383FTemplateScore& score);
+};
+
+#endif